@@ -0,0 +1,504 @@
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <execution>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Benchmarks of the search server on synthetic corpora with Zipf-distributed words.
+// Every corpus size gets a fresh index; the results go out as JSON, so runs can be compared.
+//   search_benchmark [--sizes 10000,100000] [--queries 1000] [--warmup 1] [--repetitions 5]
+//                    [--vocabulary 100000] [--zipf 1.0] [--seed 42] [--output FILE]
+// Corpora of 10M documents are supported but take tens of gigabytes
+// Every query set is first checked to rank alike with both policies; the run fails otherwise
+
+struct Options {
+    vector<size_t> sizes = {10'000, 100'000};
+    size_t query_count = 1000;
+    int warmup = 1;
+    int repetitions = 5;
+    size_t vocabulary_size = 100'000;
+    double zipf_exponent = 1.0;
+    uint64_t seed = 42;
+    string output_path;
+    size_t min_document_words = 20;
+    size_t max_document_words = 120;
+    // Share of documents repeating the words of an earlier one in another order
+    double duplicate_ratio = 0.01;
+    size_t stop_word_count = 10;
+};
+
+// Draws ranks from 0 to n - 1 with probability proportional to 1 / (rank + 1)^exponent
+class ZipfDistribution {
+public:
+    ZipfDistribution(size_t n, double exponent)
+            : cumulative_weights_(n) {
+        double total = 0.0;
+        for (size_t rank = 0; rank < n; ++rank) {
+            total += 1.0 / pow(rank + 1.0, exponent);
+            cumulative_weights_[rank] = total;
+        }
+    }
+
+    template <typename Generator>
+    size_t operator()(Generator& generator) const {
+        const double point = uniform_real_distribution<>(0.0, cumulative_weights_.back())(generator);
+        const auto it = upper_bound(cumulative_weights_.begin(), cumulative_weights_.end(), point);
+        return min<size_t>(it - cumulative_weights_.begin(), cumulative_weights_.size() - 1);
+    }
+
+private:
+    vector<double> cumulative_weights_;
+};
+
+// Words ordered by rank, the most frequent first
+vector<string> GenerateVocabulary(mt19937_64& generator, size_t word_count) {
+    set<string> seen;
+    vector<string> words;
+    words.reserve(word_count);
+    while (words.size() < word_count) {
+        // Frequent words tend to be short, as in natural text
+        const size_t max_length = 3 + 10 * words.size() / word_count;
+        const size_t length = uniform_int_distribution<size_t>(2, max_length)(generator);
+        string word;
+        for (size_t i = 0; i < length; ++i) {
+            word.push_back(uniform_int_distribution<int>('a', 'z')(generator));
+        }
+        if (seen.insert(word).second) {
+            words.push_back(move(word));
+        }
+    }
+    return words;
+}
+
+class Corpus {
+public:
+    Corpus(const Options& options)
+            : options_(options)
+            , vocabulary_([&options] {
+                mt19937_64 generator(options.seed);
+                return GenerateVocabulary(generator, options.vocabulary_size);
+            }())
+            , zipf_(vocabulary_.size(), options.zipf_exponent) {
+    }
+
+    string GetStopWords() const {
+        string stop_words;
+        for (size_t rank = 0; rank < min(options_.stop_word_count, vocabulary_.size()); ++rank) {
+            stop_words += vocabulary_[rank] + ' ';
+        }
+        return stop_words;
+    }
+
+    // Depends only on the seed and the index, so documents need not be kept
+    string GenerateDocument(size_t index) const {
+        mt19937_64 generator(GetDocumentSeed(index));
+        if (index > 0 && uniform_real_distribution<>(0.0, 1.0)(generator) < options_.duplicate_ratio) {
+            const size_t original = uniform_int_distribution<size_t>(0, index - 1)(generator);
+            vector<string_view> words = GenerateWords(original);
+            shuffle(words.begin(), words.end(), generator);
+            return JoinWords(words);
+        }
+        return JoinWords(GenerateWords(index));
+    }
+
+    string GenerateQuery(mt19937_64& generator, size_t word_count, double minus_ratio) const {
+        string query;
+        for (size_t i = 0; i < word_count; ++i) {
+            if (!query.empty()) {
+                query.push_back(' ');
+            }
+            if (uniform_real_distribution<>(0.0, 1.0)(generator) < minus_ratio) {
+                query.push_back('-');
+            }
+            query += vocabulary_[zipf_(generator)];
+        }
+        return query;
+    }
+
+private:
+    const Options& options_;
+    vector<string> vocabulary_;
+    ZipfDistribution zipf_;
+
+    uint64_t GetDocumentSeed(size_t index) const {
+        seed_seq seeds{static_cast<uint32_t>(options_.seed), static_cast<uint32_t>(options_.seed >> 32),
+                       static_cast<uint32_t>(index), static_cast<uint32_t>(static_cast<uint64_t>(index) >> 32)};
+        uint32_t parts[2];
+        seeds.generate(parts, parts + 2);
+        return (static_cast<uint64_t>(parts[0]) << 32) | parts[1];
+    }
+
+    vector<string_view> GenerateWords(size_t index) const {
+        // Skips the duplicate decision, so the words match GenerateDocument of the original
+        mt19937_64 generator(GetDocumentSeed(index));
+        uniform_real_distribution<>(0.0, 1.0)(generator);
+        const size_t word_count = uniform_int_distribution<size_t>(options_.min_document_words,
+                                                                   options_.max_document_words)(generator);
+        vector<string_view> words(word_count);
+        for (string_view& word : words) {
+            word = vocabulary_[zipf_(generator)];
+        }
+        return words;
+    }
+
+    static string JoinWords(const vector<string_view>& words) {
+        string text;
+        for (const string_view word : words) {
+            if (!text.empty()) {
+                text.push_back(' ');
+            }
+            text += word;
+        }
+        return text;
+    }
+};
+
+struct Measurement {
+    Measurement(string benchmark, string policy, size_t document_count, vector<pair<string, double>> parameters,
+                size_t operation_count)
+            : benchmark(move(benchmark))
+            , policy(move(policy))
+            , document_count(document_count)
+            , parameters(move(parameters))
+            , operation_count(operation_count) {
+    }
+
+    string benchmark;
+    string policy;
+    size_t document_count = 0;
+    vector<pair<string, double>> parameters;
+    // Operations timed in one repetition
+    size_t operation_count = 0;
+    vector<double> seconds;
+    // Folded from the results of the last repetition, equal between runs with the same seed
+    double checksum = 0.0;
+};
+
+using Clock = chrono::steady_clock;
+
+double GetSeconds(Clock::duration duration) {
+    return chrono::duration<double>(duration).count();
+}
+
+// Runs the operation warmup times untimed, then times it repetition by repetition.
+// The operation returns a checksum of its results, which also keeps them from being optimized out
+template <typename Operation>
+Measurement Measure(const Options& options, Measurement measurement, Operation operation) {
+    for (int i = 0; i < options.warmup; ++i) {
+        operation();
+    }
+    for (int i = 0; i < options.repetitions; ++i) {
+        const auto start = Clock::now();
+        measurement.checksum = operation();
+        measurement.seconds.push_back(GetSeconds(Clock::now() - start));
+    }
+    return measurement;
+}
+
+double SumRelevance(const vector<Document>& documents) {
+    double sum = 0.0;
+    for (const Document& document : documents) {
+        sum += document.relevance + document.id;
+    }
+    return sum;
+}
+
+// Sequential queries up to PRUNING_MAX_QUERY_WORDS words take the pruned path, parallel
+// ones score every posting. Both must give the same relevance and rating at every
+// rank; ids may differ only between documents that tie
+void CheckPoliciesAgree(const SearchServer& search_server, const vector<string>& queries) {
+    for (const string& query : queries) {
+        const vector<Document> seq_documents = search_server.FindTopDocuments(execution::seq, query);
+        const vector<Document> par_documents = search_server.FindTopDocuments(execution::par, query);
+        bool agree = seq_documents.size() == par_documents.size();
+        for (size_t i = 0; agree && i < seq_documents.size(); ++i) {
+            agree = abs(seq_documents[i].relevance - par_documents[i].relevance) < PRECISION
+                    && seq_documents[i].rating == par_documents[i].rating;
+        }
+        if (!agree) {
+            throw runtime_error("Sequential and parallel results differ for the query \"" + query + '"');
+        }
+    }
+}
+
+template <typename ExecutionPolicy>
+Measurement MeasureFindTopDocuments(const Options& options, const SearchServer& search_server, const char* policy_name,
+                                    ExecutionPolicy policy, const vector<string>& queries, size_t query_words,
+                                    double minus_ratio) {
+    Measurement measurement{"FindTopDocuments", policy_name, static_cast<size_t>(search_server.GetDocumentCount()),
+                            {{"query_words", static_cast<double>(query_words)}, {"minus_ratio", minus_ratio}}, queries.size()};
+    return Measure(options, move(measurement), [&] {
+        double checksum = 0.0;
+        for (const string& query : queries) {
+            checksum += SumRelevance(search_server.FindTopDocuments(policy, query));
+        }
+        return checksum;
+    });
+}
+
+template <typename ExecutionPolicy>
+Measurement MeasureMatchDocument(const Options& options, const SearchServer& search_server, const char* policy_name,
+                                 ExecutionPolicy policy, const vector<string>& queries,
+                                 const vector<int>& document_ids) {
+    Measurement measurement{"MatchDocument", policy_name, static_cast<size_t>(search_server.GetDocumentCount()),
+                            {}, queries.size()};
+    return Measure(options, move(measurement), [&] {
+        double checksum = 0.0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            const auto [words, status] = search_server.MatchDocument(policy, queries[i], document_ids[i]);
+            checksum += words.size();
+        }
+        return checksum;
+    });
+}
+
+// Every repetition removes documents of its own, taken from the back of document_ids
+template <typename ExecutionPolicy>
+Measurement MeasureRemoveDocument(const Options& options, SearchServer& search_server, const char* policy_name,
+                                  ExecutionPolicy policy, vector<int>& document_ids, size_t remove_count) {
+    Measurement measurement{"RemoveDocument", policy_name, static_cast<size_t>(search_server.GetDocumentCount()),
+                            {}, remove_count};
+    return Measure(options, move(measurement), [&] {
+        const size_t first = document_ids.size() - remove_count;
+        for (size_t i = first; i < document_ids.size(); ++i) {
+            search_server.RemoveDocument(policy, document_ids[i]);
+        }
+        document_ids.resize(first);
+        return static_cast<double>(search_server.GetDocumentCount());
+    });
+}
+
+Measurement MeasureAddDocument(const Corpus& corpus, SearchServer& search_server,
+                               size_t document_count) {
+    // Documents are generated in chunks outside of the timed part
+    const size_t chunk_size = 10'000;
+    Measurement measurement{"AddDocument", "", document_count, {}, document_count};
+    Clock::duration duration{};
+    vector<string> chunk;
+    for (size_t first = 0; first < document_count; first += chunk_size) {
+        chunk.clear();
+        for (size_t index = first; index < min(first + chunk_size, document_count); ++index) {
+            chunk.push_back(corpus.GenerateDocument(index));
+        }
+        const auto start = Clock::now();
+        for (size_t i = 0; i < chunk.size(); ++i) {
+            const int id = static_cast<int>(first + i);
+            search_server.AddDocument(id, chunk[i], DocumentStatus::ACTUAL, {id % 10, id % 7});
+        }
+        duration += Clock::now() - start;
+    }
+    measurement.seconds.push_back(GetSeconds(duration));
+    measurement.checksum = search_server.GetDocumentCount();
+    return measurement;
+}
+
+vector<Measurement> RunBenchmarks(const Options& options, const Corpus& corpus, size_t document_count) {
+    vector<Measurement> measurements;
+    const auto report = [&measurements](Measurement measurement) {
+        cerr << measurement.benchmark << ' ' << measurement.policy << ' ' << measurement.document_count << " docs: "
+             << *min_element(measurement.seconds.begin(), measurement.seconds.end()) << " s" << endl;
+        measurements.push_back(move(measurement));
+    };
+
+    SearchServer search_server(corpus.GetStopWords());
+    report(MeasureAddDocument(corpus, search_server, document_count));
+
+    mt19937_64 generator(options.seed + document_count);
+    // 70 words is the length of the queries of main.cpp
+    for (const size_t query_words : {1, 3, 8, 16, 70}) {
+        for (const double minus_ratio : {0.0, 0.25}) {
+            vector<string> queries;
+            for (size_t i = 0; i < options.query_count; ++i) {
+                queries.push_back(corpus.GenerateQuery(generator, query_words, minus_ratio));
+            }
+            CheckPoliciesAgree(search_server, queries);
+            report(MeasureFindTopDocuments(options, search_server, "seq", execution::seq, queries, query_words,
+                                           minus_ratio));
+            report(MeasureFindTopDocuments(options, search_server, "par", execution::par, queries, query_words,
+                                           minus_ratio));
+        }
+    }
+
+    vector<string> queries;
+    vector<int> document_ids;
+    for (size_t i = 0; i < options.query_count; ++i) {
+        queries.push_back(corpus.GenerateQuery(generator, 3, 0.1));
+        document_ids.push_back(uniform_int_distribution<int>(0, document_count - 1)(generator));
+    }
+    report(MeasureMatchDocument(options, search_server, "seq", execution::seq, queries, document_ids));
+    report(MeasureMatchDocument(options, search_server, "par", execution::par, queries, document_ids));
+
+    report(Measure(options, {"ProcessQueries", "par", document_count, {{"query_words", 3}, {"minus_ratio", 0.1}},
+                             queries.size()},
+                   [&] {
+                       double checksum = 0.0;
+                       for (const auto& documents : ProcessQueries(search_server, queries)) {
+                           checksum += SumRelevance(documents);
+                       }
+                       return checksum;
+                   }));
+
+    report(Measure(options, {"FindDuplicates", "", document_count, {}, document_count}, [&] {
+        return static_cast<double>(FindDuplicates(search_server).size());
+    }));
+
+    // Removals change the index, so they come after the read-only benchmarks
+    vector<int> removal_ids(document_count);
+    iota(removal_ids.begin(), removal_ids.end(), 0);
+    shuffle(removal_ids.begin(), removal_ids.end(), generator);
+    const size_t remove_count = max<size_t>(1, min<size_t>(1000, document_count / (4 * (options.warmup + options.repetitions))));
+    report(MeasureRemoveDocument(options, search_server, "seq", execution::seq, removal_ids, remove_count));
+    report(MeasureRemoveDocument(options, search_server, "par", execution::par, removal_ids, remove_count));
+
+    // Only the first run has duplicates to remove, so it is timed once
+    Measurement remove_duplicates{"RemoveDuplicates", "", static_cast<size_t>(search_server.GetDocumentCount()), {},
+                                  static_cast<size_t>(search_server.GetDocumentCount())};
+    const auto start = Clock::now();
+    RemoveDuplicates(search_server);
+    remove_duplicates.seconds.push_back(GetSeconds(Clock::now() - start));
+    remove_duplicates.checksum = search_server.GetDocumentCount();
+    report(move(remove_duplicates));
+    return measurements;
+}
+
+void WriteJson(ostream& output, const Options& options, const vector<Measurement>& measurements) {
+    output << setprecision(10);
+    output << "{\n";
+    output << "  \"seed\": " << options.seed << ",\n";
+    output << "  \"warmup\": " << options.warmup << ",\n";
+    output << "  \"repetitions\": " << options.repetitions << ",\n";
+    output << "  \"query_count\": " << options.query_count << ",\n";
+    output << "  \"vocabulary_size\": " << options.vocabulary_size << ",\n";
+    output << "  \"zipf_exponent\": " << options.zipf_exponent << ",\n";
+    output << "  \"hardware_threads\": " << thread::hardware_concurrency() << ",\n";
+    output << "  \"results\": [";
+    for (size_t i = 0; i < measurements.size(); ++i) {
+        const Measurement& measurement = measurements[i];
+        vector<double> ns_per_operation;
+        for (const double seconds : measurement.seconds) {
+            ns_per_operation.push_back(seconds * 1e9 / max<size_t>(1, measurement.operation_count));
+        }
+        sort(ns_per_operation.begin(), ns_per_operation.end());
+        const double mean = accumulate(ns_per_operation.begin(), ns_per_operation.end(), 0.0) / ns_per_operation.size();
+
+        output << (i == 0 ? "\n" : ",\n") << "    {\"benchmark\": \"" << measurement.benchmark << '"';
+        if (!measurement.policy.empty()) {
+            output << ", \"policy\": \"" << measurement.policy << '"';
+        }
+        output << ", \"documents\": " << measurement.document_count;
+        for (const auto& [name, value] : measurement.parameters) {
+            output << ", \"" << name << "\": " << value;
+        }
+        output << ", \"operations\": " << measurement.operation_count
+               << ", \"min_ns_per_op\": " << ns_per_operation.front()
+               << ", \"median_ns_per_op\": " << ns_per_operation[ns_per_operation.size() / 2]
+               << ", \"mean_ns_per_op\": " << mean
+               << ", \"max_ns_per_op\": " << ns_per_operation.back()
+               << ", \"samples_ns_per_op\": [";
+        for (size_t j = 0; j < ns_per_operation.size(); ++j) {
+            output << (j == 0 ? "" : ", ") << ns_per_operation[j];
+        }
+        output << "], \"checksum\": " << measurement.checksum << '}';
+    }
+    output << "\n  ]\n}\n";
+}
+
+vector<size_t> ParseSizes(const string& text) {
+    vector<size_t> sizes;
+    istringstream input(text);
+    for (string size; getline(input, size, ',');) {
+        sizes.push_back(stoull(size));
+        if (sizes.back() == 0) {
+            throw invalid_argument("Corpus size must be positive");
+        }
+    }
+    return sizes;
+}
+
+Options ParseOptions(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; i += 2) {
+        const string name = argv[i];
+        if (i + 1 == argc) {
+            throw invalid_argument("No value for " + name);
+        }
+        const string value = argv[i + 1];
+        if (name == "--sizes") {
+            options.sizes = ParseSizes(value);
+        } else if (name == "--queries") {
+            options.query_count = stoull(value);
+        } else if (name == "--warmup") {
+            options.warmup = stoi(value);
+        } else if (name == "--repetitions") {
+            options.repetitions = stoi(value);
+        } else if (name == "--vocabulary") {
+            options.vocabulary_size = stoull(value);
+        } else if (name == "--zipf") {
+            options.zipf_exponent = stod(value);
+        } else if (name == "--seed") {
+            options.seed = stoull(value);
+        } else if (name == "--output") {
+            options.output_path = value;
+        } else {
+            throw invalid_argument("Unknown option " + name);
+        }
+    }
+    if (options.repetitions < 1 || options.warmup < 0 || options.query_count == 0 || options.vocabulary_size == 0) {
+        throw invalid_argument("Repetitions, queries and vocabulary must be positive");
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = ParseOptions(argc, argv);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        cerr << "Usage: " << argv[0] << " [--sizes N,...] [--queries N] [--warmup N] [--repetitions N]"
+             << " [--vocabulary N] [--zipf S] [--seed N] [--output FILE]" << endl;
+        return 2;
+    }
+
+    const Corpus corpus(options);
+    vector<Measurement> measurements;
+    try {
+        for (const size_t size : options.sizes) {
+            for (Measurement& measurement : RunBenchmarks(options, corpus, size)) {
+                measurements.push_back(move(measurement));
+            }
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+
+    if (options.output_path.empty()) {
+        WriteJson(cout, options, measurements);
+        return 0;
+    }
+    ofstream output(options.output_path);
+    WriteJson(output, options, measurements);
+    if (!output) {
+        cerr << "Can not write " << options.output_path << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "block_codec.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const size_t LANE_COUNT = 4;
+const size_t VALUES_PER_LANE = BLOCK_SIZE / LANE_COUNT;
+
+uint32_t GetLowBitsMask(uint8_t bit_width) {
+    return bit_width == 32 ? ~0u : (1u << bit_width) - 1;
+}
+
+#ifndef __SSE2__
+void UnpackLane(const uint32_t* packed, uint8_t bit_width, size_t lane, uint32_t* values) {
+    const uint32_t mask = GetLowBitsMask(bit_width);
+    size_t word = 0;
+    uint32_t shift = 0;
+    for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+        uint32_t value = packed[LANE_COUNT * word + lane] >> shift;
+        shift += bit_width;
+        if (shift >= 32) {
+            ++word;
+            shift -= 32;
+            if (shift > 0) {
+                value |= packed[LANE_COUNT * word + lane] << (bit_width - shift);
+            }
+        }
+        values[LANE_COUNT * i + lane] = value & mask;
+    }
+}
+#endif
+
+} // namespace
+
+uint8_t ComputeBitWidth(const uint32_t* values) {
+    uint32_t accumulated = 0;
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        accumulated |= values[i];
+    }
+    uint8_t bit_width = 0;
+    while (accumulated != 0) {
+        ++bit_width;
+        accumulated >>= 1;
+    }
+    return bit_width;
+}
+
+void PackBlock(const uint32_t* values, uint8_t bit_width, uint32_t* packed) {
+    for (size_t i = 0; i < GetPackedWordCount(bit_width); ++i) {
+        packed[i] = 0;
+    }
+    if (bit_width == 0) {
+        return;
+    }
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        size_t word = 0;
+        uint32_t shift = 0;
+        for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+            const uint32_t value = values[LANE_COUNT * i + lane];
+            packed[LANE_COUNT * word + lane] |= value << shift;
+            shift += bit_width;
+            if (shift >= 32) {
+                ++word;
+                shift -= 32;
+                if (shift > 0) {
+                    packed[LANE_COUNT * word + lane] |= value >> (bit_width - shift);
+                }
+            }
+        }
+    }
+}
+
+#ifdef __SSE2__
+
+void UnpackBlock(const uint32_t* packed, uint8_t bit_width, uint32_t* values) {
+    __m128i* out = reinterpret_cast<__m128i*>(values);
+    if (bit_width == 0) {
+        for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+            _mm_storeu_si128(out + i, _mm_setzero_si128());
+        }
+        return;
+    }
+    const __m128i* in = reinterpret_cast<const __m128i*>(packed);
+    const __m128i mask = _mm_set1_epi32(static_cast<int>(GetLowBitsMask(bit_width)));
+    __m128i current = _mm_loadu_si128(in);
+    uint32_t shift = 0;
+    for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+        __m128i value = _mm_srl_epi32(current, _mm_cvtsi32_si128(static_cast<int>(shift)));
+        shift += bit_width;
+        if (shift >= 32) {
+            shift -= 32;
+            if (i + 1 < VALUES_PER_LANE || shift > 0) {
+                current = _mm_loadu_si128(++in);
+            }
+            if (shift > 0) {
+                value = _mm_or_si128(value, _mm_sll_epi32(current, _mm_cvtsi32_si128(static_cast<int>(bit_width - shift))));
+            }
+        }
+        _mm_storeu_si128(out + i, _mm_and_si128(value, mask));
+    }
+}
+
+void RestoreFromDeltas(uint32_t* values, uint32_t base) {
+    __m128i carry = _mm_set1_epi32(static_cast<int>(base));
+    __m128i* data = reinterpret_cast<__m128i*>(values);
+    for (size_t i = 0; i < VALUES_PER_LANE; ++i) {
+        __m128i x = _mm_loadu_si128(data + i);
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, carry);
+        _mm_storeu_si128(data + i, x);
+        carry = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+}
+
+#else
+
+void UnpackBlock(const uint32_t* packed, uint8_t bit_width, uint32_t* values) {
+    if (bit_width == 0) {
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            values[i] = 0;
+        }
+        return;
+    }
+    for (size_t lane = 0; lane < LANE_COUNT; ++lane) {
+        UnpackLane(packed, bit_width, lane, values);
+    }
+}
+
+void RestoreFromDeltas(uint32_t* values, uint32_t base) {
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+        base += values[i];
+        values[i] = base;
+    }
+}
+
+#endif
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Bit packing of blocks of BLOCK_SIZE unsigned integers. Values are interleaved
+// over 4 lanes of 32-bit words (value i goes to lane i % 4), so a block unpacks
+// with 128-bit SIMD shifts. The layout does not depend on the instruction set
+const size_t BLOCK_SIZE = 128;
+
+// Smallest bit width that fits every value of the block
+uint8_t ComputeBitWidth(const uint32_t* values);
+
+// Number of 32-bit words a packed block takes
+inline size_t GetPackedWordCount(uint8_t bit_width) {
+    return 4 * static_cast<size_t>(bit_width);
+}
+
+void PackBlock(const uint32_t* values, uint8_t bit_width, uint32_t* packed);
+
+void UnpackBlock(const uint32_t* packed, uint8_t bit_width, uint32_t* values);
+
+// Turns deltas into absolute values: values[i] = base + deltas[0] + ... + deltas[i]
+void RestoreFromDeltas(uint32_t* values, uint32_t base);
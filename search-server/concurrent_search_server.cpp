@@ -0,0 +1,57 @@
+#include "concurrent_search_server.h"
+
+#include <thread>
+
+std::vector<Document> ConcurrentSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                               size_t top_k) const {
+    return Read([raw_query, status, top_k](const SearchServer& server) {
+        return server.FindTopDocuments(raw_query, status, top_k);
+    });
+}
+
+int ConcurrentSearchServer::GetDocumentCount() const {
+    return Read([](const SearchServer& server) {
+        return server.GetDocumentCount();
+    });
+}
+
+void ConcurrentSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                         const std::vector<int>& ratings) {
+    Modify([&](SearchServer& server) {
+        server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void ConcurrentSearchServer::AddDocuments(const std::vector<NewDocument>& documents) {
+    Modify([&documents](SearchServer& server) {
+        server.AddDocuments(std::execution::par, documents);
+    });
+}
+
+void ConcurrentSearchServer::RemoveDocument(int document_id) {
+    Modify([document_id](SearchServer& server) {
+        server.RemoveDocument(document_id);
+    });
+}
+
+void ConcurrentSearchServer::Compact() {
+    Modify([](SearchServer& server) {
+        server.Compact();
+    });
+}
+
+void ConcurrentSearchServer::SwitchCopies() {
+    const auto wait_for_readers = [this](size_t version) {
+        while (read_counters_[version].count.load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    };
+    active_.store(1 - active_.load(std::memory_order_relaxed), std::memory_order_seq_cst);
+    // New readers already use the new copy. The ones counted on either version may
+    // still use the old one: first let the spare counter drain and move new readers
+    // onto it, then wait for the readers of the current counter to leave
+    const size_t version = version_.load(std::memory_order_relaxed);
+    wait_for_readers(1 - version);
+    version_.store(1 - version, std::memory_order_seq_cst);
+    wait_for_readers(version);
+}
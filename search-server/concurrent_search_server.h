@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+// SearchServer that serves queries while it is being modified. It keeps two copies
+// of the index (the left-right scheme): readers use the active copy, and the single
+// writer changes the inactive one, makes it active and, once the readers of the old
+// copy are gone, repeats the change there. Reads are wait-free and never wait for
+// a writer, writes wait for the reads they overlap with. The price is twice the
+// memory and twice the indexing work
+class ConcurrentSearchServer {
+public:
+    // Both copies are built from the same arguments, as SearchServer(args...)
+    template <typename... Args>
+    explicit ConcurrentSearchServer(const Args&... args)
+            : servers_{SearchServer(args...), SearchServer(args...)} {
+    }
+
+    ConcurrentSearchServer(const ConcurrentSearchServer&) = delete;
+    ConcurrentSearchServer& operator=(const ConcurrentSearchServer&) = delete;
+
+    // Calls reader(const SearchServer&) on the current version of the index. The
+    // reference must not outlive the call
+    template <typename Reader>
+    auto Read(Reader reader) const {
+        const size_t version = version_.load(std::memory_order_seq_cst);
+        const ReadGuard guard(read_counters_[version].count);
+        return reader(servers_[active_.load(std::memory_order_seq_cst)]);
+    }
+
+    // Applies writer(SearchServer&) to the index, one writer at a time. Readers see
+    // either the old or the new version. writer runs once per copy, so it has to
+    // change both the same way. If it throws on the first copy nothing is changed
+    template <typename Writer>
+    void Modify(Writer writer);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    int GetDocumentCount() const;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    void AddDocuments(const std::vector<NewDocument>& documents);
+
+    void RemoveDocument(int document_id);
+
+    void Compact();
+
+private:
+    struct alignas(64) ReadCounter {
+        std::atomic<size_t> count = 0;
+    };
+
+    class ReadGuard {
+    public:
+        explicit ReadGuard(std::atomic<size_t>& count)
+                : count_(count) {
+            count_.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ~ReadGuard() {
+            count_.fetch_sub(1, std::memory_order_seq_cst);
+        }
+
+    private:
+        std::atomic<size_t>& count_;
+    };
+
+    std::array<SearchServer, 2> servers_;
+    // Copy the readers use
+    std::atomic<size_t> active_ = 0;
+    // Counter the readers register at. Readers that may still use the inactive
+    // copy are counted on the other one
+    std::atomic<size_t> version_ = 0;
+    mutable std::array<ReadCounter, 2> read_counters_;
+    std::mutex write_mutex_;
+
+    // Makes the inactive copy active and waits until no reader uses the other one
+    void SwitchCopies();
+};
+
+template <typename Writer>
+void ConcurrentSearchServer::Modify(Writer writer) {
+    std::lock_guard guard(write_mutex_);
+    writer(servers_[1 - active_.load(std::memory_order_relaxed)]);
+    SwitchCopies();
+    writer(servers_[1 - active_.load(std::memory_order_relaxed)]);
+}
@@ -2,6 +2,8 @@
 #pragma once
 
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 struct Document {
     Document() = default;
@@ -20,4 +22,12 @@ enum class DocumentStatus {
     IRRELEVANT,
     BANNED,
     REMOVED,
-};
\ No newline at end of file
+};
+
+// One entry of a SearchServer::AddDocuments batch
+struct NewDocument {
+    int id = 0;
+    std::string_view text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
@@ -0,0 +1,27 @@
+#include "forward_index.h"
+
+void ForwardIndex::Add(const std::vector<TermFrequency>& terms) {
+    entries_.insert(entries_.end(), terms.begin(), terms.end());
+    offsets_.push_back(entries_.size());
+}
+
+void ForwardIndex::Compact(const std::vector<DocumentOrdinal>& new_ordinals) {
+    size_t entry_count = 0;
+    size_t document_count = 0;
+    for (DocumentOrdinal ordinal = 0; ordinal < size(); ++ordinal) {
+        if (new_ordinals[ordinal] == REMOVED_ORDINAL) {
+            continue;
+        }
+        // Entries only move towards the front, so they are compacted in place
+        const size_t first = offsets_[ordinal];
+        const size_t last = offsets_[ordinal + 1];
+        for (size_t i = first; i < last; ++i) {
+            entries_[entry_count++] = entries_[i];
+        }
+        offsets_[++document_count] = entry_count;
+    }
+    entries_.resize(entry_count);
+    entries_.shrink_to_fit();
+    offsets_.resize(document_count + 1);
+    offsets_.shrink_to_fit();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "posting_list.h"
+#include "term_dictionary.h"
+
+struct TermFrequency {
+    TermId term;
+    double term_freq;
+};
+
+// Terms of one document sorted by term id
+class TermFrequencyRange {
+public:
+    TermFrequencyRange() = default;
+
+    TermFrequencyRange(const TermFrequency* first, const TermFrequency* last)
+            : first_(first)
+            , last_(last) {
+    }
+
+    const TermFrequency* begin() const noexcept {
+        return first_;
+    }
+
+    const TermFrequency* end() const noexcept {
+        return last_;
+    }
+
+    size_t size() const noexcept {
+        return last_ - first_;
+    }
+
+    bool empty() const noexcept {
+        return first_ == last_;
+    }
+
+private:
+    const TermFrequency* first_ = nullptr;
+    const TermFrequency* last_ = nullptr;
+};
+
+// Terms of every document indexed by ordinal. The terms of all documents share
+// one flat array, a document takes the entries between two neighbouring offsets
+class ForwardIndex {
+public:
+    // Terms of the document with the next ordinal, sorted by term id
+    void Add(const std::vector<TermFrequency>& terms);
+
+    TermFrequencyRange Get(DocumentOrdinal ordinal) const noexcept {
+        return {entries_.data() + offsets_[ordinal], entries_.data() + offsets_[ordinal + 1]};
+    }
+
+    // Drops the documents mapped to REMOVED_ORDINAL. The mapping has to keep
+    // the order of the ordinals that remain
+    void Compact(const std::vector<DocumentOrdinal>& new_ordinals);
+
+    // Number of documents
+    size_t size() const noexcept {
+        return offsets_.size() - 1;
+    }
+
+    const std::vector<TermFrequency>& GetEntries() const noexcept {
+        return entries_;
+    }
+
+    // size() + 1 entries, the first one is zero
+    const std::vector<uint64_t>& GetOffsets() const noexcept {
+        return offsets_;
+    }
+
+private:
+    std::vector<TermFrequency> entries_;
+    std::vector<uint64_t> offsets_ = {0};
+};
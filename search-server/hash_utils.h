@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+// Finalizer of SplitMix64. Every input bit affects every output bit, so chained
+// calls hash sequences of integers, and distinct seeds give independent hashes
+inline uint64_t MixHash(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
@@ -0,0 +1,261 @@
+#include "instrumentation.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <iomanip>
+#include <memory>
+
+namespace {
+
+// Log-linear buckets like HDR histograms: values below 32 ns get a bucket each,
+// every further power of two is split into 32 buckets of equal width
+const size_t SUB_BUCKET_BITS = 5;
+const size_t SUB_BUCKET_COUNT = size_t{1} << SUB_BUCKET_BITS;
+const size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+size_t GetBucketIndex(uint64_t value) {
+    if (value < SUB_BUCKET_COUNT) {
+        return value;
+    }
+    const size_t magnitude = 63 - __builtin_clzll(value);
+    const size_t shift = magnitude - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKET_COUNT + ((value >> shift) - SUB_BUCKET_COUNT);
+}
+
+// Middle of the values the bucket stands for
+uint64_t GetBucketValue(size_t index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const size_t shift = index / SUB_BUCKET_COUNT - 1;
+    const uint64_t lowest = (SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+    return lowest + ((uint64_t{1} << shift) >> 1);
+}
+
+// Only the owning thread writes, so a relaxed load and store replace a read-modify-write
+void AddRelaxed(std::atomic<uint64_t>& target, uint64_t value) {
+    target.store(target.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct Histogram {
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> buckets;
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> max;
+};
+
+struct ThreadRecorder {
+    std::array<Histogram, QUERY_STAGE_COUNT> histograms;
+    std::array<std::atomic<uint64_t>, QUERY_COUNTER_COUNT> counters;
+    bool is_used;
+};
+
+// Recorders of finished threads keep their records and are handed to new threads
+class RecorderRegistry {
+public:
+    ThreadRecorder* Acquire() {
+        std::lock_guard guard(mutex_);
+        for (const auto& recorder : recorders_) {
+            if (!recorder->is_used) {
+                recorder->is_used = true;
+                return recorder.get();
+            }
+        }
+        // Value-initialized, so every atomic starts at zero
+        recorders_.push_back(std::make_unique<ThreadRecorder>());
+        recorders_.back()->is_used = true;
+        return recorders_.back().get();
+    }
+
+    void Release(ThreadRecorder* recorder) {
+        std::lock_guard guard(mutex_);
+        recorder->is_used = false;
+    }
+
+    template <typename Function>
+    void ForEach(Function function) {
+        std::lock_guard guard(mutex_);
+        for (const auto& recorder : recorders_) {
+            function(*recorder);
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<ThreadRecorder>> recorders_;
+};
+
+// Never destroyed, so threads finishing after main still find it
+RecorderRegistry& GetRegistry() {
+    static RecorderRegistry* registry = new RecorderRegistry;
+    return *registry;
+}
+
+class RecorderLease {
+public:
+    RecorderLease()
+            : recorder_(GetRegistry().Acquire()) {
+    }
+
+    ~RecorderLease() {
+        GetRegistry().Release(recorder_);
+    }
+
+    ThreadRecorder& operator*() const noexcept {
+        return *recorder_;
+    }
+
+private:
+    ThreadRecorder* recorder_;
+};
+
+ThreadRecorder& GetThreadRecorder() {
+    thread_local RecorderLease lease;
+    return *lease;
+}
+
+uint64_t FindPercentile(const std::array<uint64_t, BUCKET_COUNT>& buckets, uint64_t count, double percentile) {
+    // Rank of the value in the ordered records, counted from one
+    const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(percentile * count + 0.5));
+    uint64_t seen = 0;
+    for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+        seen += buckets[index];
+        if (seen >= rank) {
+            return GetBucketValue(index);
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+std::string_view GetQueryStageName(QueryStage stage) {
+    switch (stage) {
+        case QueryStage::PARSE:
+            return "parse";
+        case QueryStage::POSTING_TRAVERSAL:
+            return "posting_traversal";
+        case QueryStage::SCORING:
+            return "scoring";
+        case QueryStage::TOP_K:
+            return "top_k";
+        case QueryStage::PREDICATE:
+            return "predicate";
+        case QueryStage::QUERY:
+            return "query";
+    }
+    return "unknown";
+}
+
+std::string_view GetQueryCounterName(QueryCounter counter) {
+    switch (counter) {
+        case QueryCounter::POSTINGS:
+            return "postings";
+        case QueryCounter::PREDICATE_CALLS:
+            return "predicate_calls";
+    }
+    return "unknown";
+}
+
+void RecordQueryStage(QueryStage stage, uint64_t nanoseconds) {
+    Histogram& histogram = GetThreadRecorder().histograms[static_cast<size_t>(stage)];
+    AddRelaxed(histogram.buckets[GetBucketIndex(nanoseconds)], 1);
+    AddRelaxed(histogram.total, nanoseconds);
+    if (nanoseconds > histogram.max.load(std::memory_order_relaxed)) {
+        histogram.max.store(nanoseconds, std::memory_order_relaxed);
+    }
+}
+
+void AddQueryCounter(QueryCounter counter, uint64_t value) {
+    AddRelaxed(GetThreadRecorder().counters[static_cast<size_t>(counter)], value);
+}
+
+InstrumentationSnapshot GetInstrumentationSnapshot() {
+    // Too large for the stack of a small thread
+    std::vector<std::array<uint64_t, BUCKET_COUNT>> buckets(QUERY_STAGE_COUNT);
+    InstrumentationSnapshot snapshot;
+    for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+        snapshot.stages.push_back({static_cast<QueryStage>(stage)});
+    }
+    for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+        snapshot.counters.emplace_back(static_cast<QueryCounter>(counter), 0);
+    }
+    GetRegistry().ForEach([&](const ThreadRecorder& recorder) {
+        for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+            const Histogram& histogram = recorder.histograms[stage];
+            StageStatistics& statistics = snapshot.stages[stage];
+            statistics.total_ns += histogram.total.load(std::memory_order_relaxed);
+            statistics.max_ns = std::max(statistics.max_ns, histogram.max.load(std::memory_order_relaxed));
+            for (size_t index = 0; index < BUCKET_COUNT; ++index) {
+                buckets[stage][index] += histogram.buckets[index].load(std::memory_order_relaxed);
+            }
+        }
+        for (size_t counter = 0; counter < QUERY_COUNTER_COUNT; ++counter) {
+            snapshot.counters[counter].second += recorder.counters[counter].load(std::memory_order_relaxed);
+        }
+    });
+    for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+        StageStatistics& statistics = snapshot.stages[stage];
+        // Counted from the buckets, so that the percentiles agree with the count
+        for (const uint64_t bucket : buckets[stage]) {
+            statistics.count += bucket;
+        }
+        statistics.p50_ns = FindPercentile(buckets[stage], statistics.count, 0.5);
+        statistics.p99_ns = FindPercentile(buckets[stage], statistics.count, 0.99);
+        statistics.p999_ns = FindPercentile(buckets[stage], statistics.count, 0.999);
+    }
+    return snapshot;
+}
+
+void ResetInstrumentation() {
+    GetRegistry().ForEach([](ThreadRecorder& recorder) {
+        for (Histogram& histogram : recorder.histograms) {
+            for (auto& bucket : histogram.buckets) {
+                bucket.store(0, std::memory_order_relaxed);
+            }
+            histogram.total.store(0, std::memory_order_relaxed);
+            histogram.max.store(0, std::memory_order_relaxed);
+        }
+        for (auto& counter : recorder.counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    });
+}
+
+void DumpInstrumentation(std::ostream& output) {
+    const InstrumentationSnapshot snapshot = GetInstrumentationSnapshot();
+    output << std::left << std::setw(20) << "stage" << std::right << std::setw(12) << "count"
+           << std::setw(12) << "p50_ns" << std::setw(12) << "p99_ns" << std::setw(12) << "p999_ns"
+           << std::setw(12) << "max_ns" << '\n';
+    for (const StageStatistics& statistics : snapshot.stages) {
+        output << std::left << std::setw(20) << GetQueryStageName(statistics.stage) << std::right
+               << std::setw(12) << statistics.count << std::setw(12) << statistics.p50_ns
+               << std::setw(12) << statistics.p99_ns << std::setw(12) << statistics.p999_ns
+               << std::setw(12) << statistics.max_ns << '\n';
+    }
+    for (const auto& [counter, value] : snapshot.counters) {
+        output << std::left << std::setw(20) << GetQueryCounterName(counter) << std::right
+               << std::setw(12) << value << '\n';
+    }
+    output << std::flush;
+}
+
+InstrumentationReporter::InstrumentationReporter(std::ostream& output, std::chrono::milliseconds period)
+        : thread_([this, &output, period] {
+            std::unique_lock lock(mutex_);
+            while (!stop_condition_.wait_for(lock, period, [this] {
+                return is_stopping_;
+            })) {
+                DumpInstrumentation(output);
+            }
+        }) {
+}
+
+InstrumentationReporter::~InstrumentationReporter() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopping_ = true;
+    }
+    stop_condition_.notify_one();
+    thread_.join();
+}
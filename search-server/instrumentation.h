@@ -0,0 +1,150 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Latency histograms of the stages of a query. Every thread records into histograms
+// of its own with plain atomic stores, so recording takes no lock and no shared
+// cache line. The macros below place the probes; built without
+// SEARCH_SERVER_INSTRUMENTATION they expand to nothing and the hot path pays nothing.
+// The functions stay available and report empty statistics then
+
+enum class QueryStage {
+    // Tokenizing the query and resolving its words to terms
+    PARSE,
+    // Walking the posting list of one word and accumulating its scores, or the whole
+    // dynamic pruning loop of a query, which interleaves the lists
+    POSTING_TRAVERSAL,
+    // Summing partial scores and turning them into documents
+    SCORING,
+    // Selecting and ordering the best documents
+    TOP_K,
+    // One call of the document predicate. Only every PREDICATE_SAMPLE_PERIOD-th
+    // call is timed, the clock would cost more than a typical predicate
+    PREDICATE,
+    // A whole FindTopDocuments after parsing
+    QUERY,
+};
+
+enum class QueryCounter {
+    // Entries of the posting lists walked in full
+    POSTINGS,
+    // Counted in steps of PREDICATE_SAMPLE_PERIOD, when a call is sampled
+    PREDICATE_CALLS,
+};
+
+constexpr size_t QUERY_STAGE_COUNT = 6;
+constexpr size_t QUERY_COUNTER_COUNT = 2;
+constexpr uint64_t PREDICATE_SAMPLE_PERIOD = 64;
+
+std::string_view GetQueryStageName(QueryStage stage);
+std::string_view GetQueryCounterName(QueryCounter counter);
+
+struct StageStatistics {
+    QueryStage stage;
+    uint64_t count = 0;
+    uint64_t total_ns = 0;
+    // Percentiles are exact up to 1/32 of the value
+    uint64_t p50_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+struct InstrumentationSnapshot {
+    std::vector<StageStatistics> stages;
+    std::vector<std::pair<QueryCounter, uint64_t>> counters;
+};
+
+// Sums the histograms of all threads, including threads that have finished. Recording
+// goes on meanwhile, so a snapshot may miss the latest few records
+InstrumentationSnapshot GetInstrumentationSnapshot();
+
+// Clears all histograms and counters. Records made during the reset may survive it
+void ResetInstrumentation();
+
+// One line per stage with its count and percentiles, then the counters
+void DumpInstrumentation(std::ostream& output);
+
+void RecordQueryStage(QueryStage stage, uint64_t nanoseconds);
+void AddQueryCounter(QueryCounter counter, uint64_t value);
+
+// Adds the time from construction to destruction to the histogram of the stage
+class ScopedStageTimer {
+public:
+    explicit ScopedStageTimer(QueryStage stage)
+            : stage_(stage) {
+    }
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+
+    ~ScopedStageTimer() {
+        RecordQueryStage(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now() - start_).count());
+    }
+
+private:
+    QueryStage stage_;
+    std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+};
+
+// Writes DumpInstrumentation to the stream every period until destroyed
+class InstrumentationReporter {
+public:
+    InstrumentationReporter(std::ostream& output, std::chrono::milliseconds period);
+    ~InstrumentationReporter();
+
+    InstrumentationReporter(const InstrumentationReporter&) = delete;
+    InstrumentationReporter& operator=(const InstrumentationReporter&) = delete;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable stop_condition_;
+    bool is_stopping_ = false;
+    std::thread thread_;
+};
+
+#define INSTRUMENTATION_CONCAT_INTERNAL(X, Y) X##Y
+#define INSTRUMENTATION_CONCAT(X, Y) INSTRUMENTATION_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_INSTRUMENTATION
+
+#define INSTRUMENT_STAGE(stage) ScopedStageTimer INSTRUMENTATION_CONCAT(stageTimer, __LINE__)(stage)
+#define INSTRUMENT_COUNT(counter, value) AddQueryCounter(counter, value)
+
+// Predicate calls of the thread since the last sampled one. A plain thread_local,
+// so that the calls between samples cost one increment
+inline thread_local uint64_t unsampled_predicate_calls = 0;
+
+// Calls the predicate, timing and counting every PREDICATE_SAMPLE_PERIOD-th call
+template <typename Predicate, typename... Args>
+bool CallInstrumentedPredicate(Predicate& predicate, const Args&... args) {
+    if (++unsampled_predicate_calls < PREDICATE_SAMPLE_PERIOD) {
+        return predicate(args...);
+    }
+    unsampled_predicate_calls = 0;
+    AddQueryCounter(QueryCounter::PREDICATE_CALLS, PREDICATE_SAMPLE_PERIOD);
+    INSTRUMENT_STAGE(QueryStage::PREDICATE);
+    return predicate(args...);
+}
+
+#else
+
+#define INSTRUMENT_STAGE(stage)
+#define INSTRUMENT_COUNT(counter, value)
+
+template <typename Predicate, typename... Args>
+bool CallInstrumentedPredicate(Predicate& predicate, const Args&... args) {
+    return predicate(args...);
+}
+
+#endif
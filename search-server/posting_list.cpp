@@ -0,0 +1,250 @@
+#include "posting_list.h"
+
+#include <algorithm>
+
+namespace {
+
+bool PostingLess(const PostingListView::Posting& posting, DocumentOrdinal ordinal) {
+    return posting.ordinal < ordinal;
+}
+
+} // namespace
+
+bool PostingListView::Contains(DocumentOrdinal ordinal) const {
+    const auto block_it = std::lower_bound(parts_.blocks, parts_.blocks + parts_.block_count, ordinal,
+                                           [](const Block& block, DocumentOrdinal ordinal) {
+                                               return block.last_ordinal < ordinal;
+                                           });
+    if (block_it != parts_.blocks + parts_.block_count) {
+        if (ordinal < block_it->first_ordinal) {
+            return false;
+        }
+        alignas(16) DocumentOrdinal ordinals[BLOCK_SIZE];
+        DecodeOrdinals(block_it - parts_.blocks, ordinals);
+        return std::binary_search(ordinals, ordinals + BLOCK_SIZE, ordinal);
+    }
+    const auto it = std::lower_bound(parts_.postings, parts_.postings + parts_.posting_count, ordinal, PostingLess);
+    return it != parts_.postings + parts_.posting_count && it->ordinal == ordinal;
+}
+
+DocumentOrdinal PostingListView::GetBlockLastOrdinal(size_t block_index) const {
+    if (block_index < parts_.block_count) {
+        return parts_.blocks[block_index].last_ordinal;
+    }
+    const size_t tail_end = std::min((block_index - parts_.block_count + 1) * BLOCK_SIZE, parts_.posting_count);
+    return parts_.postings[tail_end - 1].ordinal;
+}
+
+void PostingListView::DecodeOrdinals(size_t block_index, DocumentOrdinal* ordinals) const {
+    const Block& block = parts_.blocks[block_index];
+    UnpackBlock(parts_.packed_deltas + block.packed_offset, block.bit_width, ordinals);
+    RestoreFromDeltas(ordinals, block.first_ordinal);
+}
+
+void PostingList::Add(DocumentOrdinal ordinal, double term_freq) {
+    const bool is_after_blocks = blocks_.empty() || blocks_.back().last_ordinal < ordinal;
+    if (is_after_blocks && (postings_.empty() || postings_.back().ordinal < ordinal)) {
+        if (size() % BLOCK_SIZE == 0) {
+            block_max_term_freqs_.push_back(term_freq);
+        } else {
+            block_max_term_freqs_.back() = std::max(block_max_term_freqs_.back(), term_freq);
+        }
+        max_term_freq_ = std::max(max_term_freq_, term_freq);
+        postings_.push_back({ordinal, term_freq});
+        if (format_ == Format::COMPRESSED && postings_.size() == BLOCK_SIZE) {
+            SealBlocks();
+        }
+        UpdateLogDocumentFreq();
+        return;
+    }
+    // Out of order insertion rebuilds the sealed blocks
+    auto postings = ExtractPostings();
+    auto it = std::lower_bound(postings.begin(), postings.end(), ordinal, PostingLess);
+    if (it != postings.end() && it->ordinal == ordinal) {
+        it->term_freq += term_freq;
+    } else {
+        postings.insert(it, {ordinal, term_freq});
+    }
+    Assign(std::move(postings));
+}
+
+void PostingList::Compact(const std::vector<DocumentOrdinal>& new_ordinals) {
+    auto postings = ExtractPostings();
+    auto out = postings.begin();
+    for (const Posting& posting : postings) {
+        const DocumentOrdinal ordinal = new_ordinals[posting.ordinal];
+        if (ordinal != REMOVED_ORDINAL) {
+            *out++ = {ordinal, posting.term_freq};
+        }
+    }
+    postings.erase(out, postings.end());
+    postings.shrink_to_fit();
+    removed_count_ = 0;
+    Assign(std::move(postings));
+}
+
+void PostingList::SetFormat(Format format) {
+    if (format == format_) {
+        return;
+    }
+    auto postings = ExtractPostings();
+    format_ = format;
+    Assign(std::move(postings));
+}
+
+PostingListView PostingList::View() const noexcept {
+    PostingListView::Parts parts;
+    parts.postings = postings_.data();
+    parts.posting_count = postings_.size();
+    parts.blocks = blocks_.data();
+    parts.block_count = blocks_.size();
+    parts.packed_deltas = packed_deltas_.data();
+    parts.block_term_freqs = block_term_freqs_.data();
+    parts.block_max_term_freqs = block_max_term_freqs_.data();
+    parts.max_term_freq = max_term_freq_;
+    parts.document_freq = GetDocumentFreq();
+    parts.log_document_freq = log_document_freq_;
+    return PostingListView(parts);
+}
+
+void PostingList::Assign(std::vector<Posting> postings) {
+    block_max_term_freqs_.clear();
+    max_term_freq_ = 0.0;
+    for (size_t i = 0; i < postings.size(); ++i) {
+        const double term_freq = postings[i].term_freq;
+        if (i % BLOCK_SIZE == 0) {
+            block_max_term_freqs_.push_back(term_freq);
+        } else {
+            block_max_term_freqs_.back() = std::max(block_max_term_freqs_.back(), term_freq);
+        }
+        max_term_freq_ = std::max(max_term_freq_, term_freq);
+    }
+    postings_ = std::move(postings);
+    SealBlocks();
+    UpdateLogDocumentFreq();
+}
+
+void PostingList::SealBlocks() {
+    if (format_ != Format::COMPRESSED) {
+        return;
+    }
+    size_t sealed = 0;
+    uint32_t deltas[BLOCK_SIZE];
+    for (; sealed + BLOCK_SIZE <= postings_.size(); sealed += BLOCK_SIZE) {
+        const Posting* postings = postings_.data() + sealed;
+        deltas[0] = 0;
+        for (size_t i = 1; i < BLOCK_SIZE; ++i) {
+            deltas[i] = postings[i].ordinal - postings[i - 1].ordinal;
+        }
+        const uint8_t bit_width = ComputeBitWidth(deltas);
+        const auto packed_offset = static_cast<uint32_t>(packed_deltas_.size());
+        packed_deltas_.resize(packed_deltas_.size() + GetPackedWordCount(bit_width));
+        PackBlock(deltas, bit_width, packed_deltas_.data() + packed_offset);
+        blocks_.push_back({postings[0].ordinal, postings[BLOCK_SIZE - 1].ordinal, bit_width, packed_offset});
+        // Bounds have to hold for the rounded frequencies as well
+        double& block_max_term_freq = block_max_term_freqs_[blocks_.size() - 1];
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            const float term_freq = static_cast<float>(postings[i].term_freq);
+            block_term_freqs_.push_back(term_freq);
+            block_max_term_freq = std::max(block_max_term_freq, static_cast<double>(term_freq));
+        }
+        max_term_freq_ = std::max(max_term_freq_, block_max_term_freq);
+    }
+    postings_.erase(postings_.begin(), postings_.begin() + sealed);
+    if (postings_.empty()) {
+        postings_.shrink_to_fit();
+    }
+}
+
+std::vector<PostingList::Posting> PostingList::ExtractPostings() {
+    std::vector<Posting> postings;
+    postings.reserve(size());
+    ForEach([&postings](DocumentOrdinal ordinal, double term_freq) {
+        postings.push_back({ordinal, term_freq});
+    });
+    blocks_.clear();
+    packed_deltas_.clear();
+    block_term_freqs_.clear();
+    postings_.clear();
+    return postings;
+}
+
+PostingListView::Cursor::Cursor(const PostingListView& postings)
+        : postings_(postings) {
+    if (!postings.empty()) {
+        LoadBlock(0);
+    }
+}
+
+void PostingListView::Cursor::Next() {
+    if (++position_ < block_size_) {
+        ordinal_ = ordinals_[position_];
+    } else if (block_ + 1 < postings_.GetBlockCount()) {
+        LoadBlock(block_ + 1);
+    } else {
+        ordinal_ = END;
+    }
+}
+
+void PostingListView::Cursor::SkipTo(DocumentOrdinal ordinal) {
+    if (ordinal <= ordinal_) {
+        return;
+    }
+    if (ordinal > ordinals_[block_size_ - 1]) {
+        if (!ShallowSkipTo(ordinal)) {
+            ordinal_ = END;
+            return;
+        }
+        LoadBlock(shallow_block_);
+    }
+    position_ = std::lower_bound(ordinals_ + position_, ordinals_ + block_size_, ordinal) - ordinals_;
+    ordinal_ = ordinals_[position_];
+}
+
+bool PostingListView::Cursor::ShallowSkipTo(DocumentOrdinal ordinal) {
+    const size_t block_count = postings_.GetBlockCount();
+    // Targets are usually close, so gallop before the binary search
+    size_t step = 1;
+    size_t first = shallow_block_;
+    while (first < block_count && postings_.GetBlockLastOrdinal(first) < ordinal) {
+        first = shallow_block_ + step;
+        step *= 2;
+    }
+    size_t last = std::min(first, block_count);
+    first = std::max(shallow_block_, last - std::min(last, step / 2));
+    while (first < last) {
+        const size_t middle = first + (last - first) / 2;
+        if (postings_.GetBlockLastOrdinal(middle) < ordinal) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    if (first == block_count) {
+        return false;
+    }
+    shallow_block_ = first;
+    return true;
+}
+
+void PostingListView::Cursor::LoadBlock(size_t block_index) {
+    block_ = block_index;
+    shallow_block_ = std::max(shallow_block_, block_index);
+    position_ = 0;
+    const PostingListView::Parts& parts = postings_.parts_;
+    if (block_index < parts.block_count) {
+        postings_.DecodeOrdinals(block_index, ordinals_);
+        const float* term_freqs = parts.block_term_freqs + block_index * BLOCK_SIZE;
+        std::copy(term_freqs, term_freqs + BLOCK_SIZE, term_freqs_);
+        block_size_ = BLOCK_SIZE;
+    } else {
+        const size_t offset = (block_index - parts.block_count) * BLOCK_SIZE;
+        block_size_ = std::min(BLOCK_SIZE, parts.posting_count - offset);
+        for (size_t i = 0; i < block_size_; ++i) {
+            const Posting& posting = parts.postings[offset + i];
+            ordinals_[i] = posting.ordinal;
+            term_freqs_[i] = posting.term_freq;
+        }
+    }
+    ordinal_ = ordinals_[0];
+}
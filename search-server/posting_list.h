@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "block_codec.h"
+
+// Dense internal number of a document, assigned in the order documents are added
+using DocumentOrdinal = uint32_t;
+
+// Marks documents dropped by PostingList::Compact
+constexpr DocumentOrdinal REMOVED_ORDINAL = std::numeric_limits<DocumentOrdinal>::max();
+
+// Read-only view of the postings of a single word, sorted by ordinal.
+// Queries only use views, so they do not depend on whether the postings
+// belong to a PostingList or to a mapped index snapshot
+class PostingListView {
+public:
+    struct Posting {
+        DocumentOrdinal ordinal;
+        double term_freq;
+    };
+
+    struct Block {
+        DocumentOrdinal first_ordinal;
+        DocumentOrdinal last_ordinal;
+        uint8_t bit_width;
+        // Offset of the packed deltas in Parts::packed_deltas
+        uint32_t packed_offset;
+    };
+
+    // Arrays behind the view. Sealed blocks of bit-packed ordinal deltas
+    // come first, the plain postings follow them
+    struct Parts {
+        const Posting* postings = nullptr;
+        size_t posting_count = 0;
+        const Block* blocks = nullptr;
+        size_t block_count = 0;
+        const uint32_t* packed_deltas = nullptr;
+        // BLOCK_SIZE entries per sealed block
+        const float* block_term_freqs = nullptr;
+        // Upper bounds for dynamic pruning, per block of BLOCK_SIZE postings,
+        // sealed or not, and for the whole list
+        const double* block_max_term_freqs = nullptr;
+        double max_term_freq = 0.0;
+        // Postings of documents that are not removed
+        size_t document_freq = 0;
+        double log_document_freq = -std::numeric_limits<double>::infinity();
+    };
+
+    // Forward iterator over the postings that can also skip whole blocks.
+    // The postings must not change while a cursor is in use
+    class Cursor;
+
+    PostingListView() = default;
+
+    explicit PostingListView(const Parts& parts)
+            : parts_(parts) {
+    }
+
+    const Parts& GetParts() const noexcept {
+        return parts_;
+    }
+
+    bool Contains(DocumentOrdinal ordinal) const;
+
+    // Calls function(ordinal, term_freq) for every posting in ascending order
+    template <typename Function>
+    void ForEach(Function function) const;
+
+    // Postings are grouped into blocks of BLOCK_SIZE whether sealed or not
+    size_t GetBlockCount() const noexcept {
+        return (size() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    DocumentOrdinal GetBlockLastOrdinal(size_t block_index) const;
+
+    double GetMaxTermFreq() const noexcept {
+        return parts_.max_term_freq;
+    }
+
+    size_t GetDocumentFreq() const noexcept {
+        return parts_.document_freq;
+    }
+
+    // Natural logarithm of GetDocumentFreq(), kept current so queries never compute it
+    double GetLogDocumentFreq() const noexcept {
+        return parts_.log_document_freq;
+    }
+
+    size_t size() const noexcept {
+        return parts_.block_count * BLOCK_SIZE + parts_.posting_count;
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+private:
+    Parts parts_;
+
+    void DecodeOrdinals(size_t block_index, DocumentOrdinal* ordinals) const;
+};
+
+class PostingListView::Cursor {
+public:
+    // Ordinal of an exhausted cursor, greater than any real one
+    static constexpr DocumentOrdinal END = std::numeric_limits<DocumentOrdinal>::max();
+
+    explicit Cursor(const PostingListView& postings);
+
+    bool IsEnd() const noexcept {
+        return ordinal_ == END;
+    }
+
+    DocumentOrdinal GetOrdinal() const noexcept {
+        return ordinal_;
+    }
+
+    double GetTermFreq() const noexcept {
+        return term_freqs_[position_];
+    }
+
+    void Next();
+
+    // Moves to the first posting with ordinal not less than the given one
+    void SkipTo(DocumentOrdinal ordinal);
+
+    // Moves only the block bounds to the block that may hold the ordinal
+    // without decoding it. Returns false when no such block exists
+    bool ShallowSkipTo(DocumentOrdinal ordinal);
+
+    double GetBlockMaxTermFreq() const {
+        return postings_.parts_.block_max_term_freqs[shallow_block_];
+    }
+
+    DocumentOrdinal GetBlockLastOrdinal() const {
+        return postings_.GetBlockLastOrdinal(shallow_block_);
+    }
+
+private:
+    PostingListView postings_;
+    DocumentOrdinal ordinal_ = END;
+    size_t block_ = 0;
+    size_t shallow_block_ = 0;
+    size_t position_ = 0;
+    size_t block_size_ = 0;
+    DocumentOrdinal ordinals_[BLOCK_SIZE];
+    double term_freqs_[BLOCK_SIZE];
+
+    void LoadBlock(size_t block_index);
+};
+
+// Inverted list of a single word: (ordinal, term_freq) pairs sorted by ordinal
+// and scanned linearly by queries.
+// PLAIN keeps them in a contiguous array. COMPRESSED seals every BLOCK_SIZE
+// postings into a block of bit-packed ordinal deltas and single precision
+// frequencies, only the unsealed tail stays plain
+class PostingList {
+public:
+    enum class Format {
+        PLAIN,
+        COMPRESSED,
+    };
+
+    using Posting = PostingListView::Posting;
+
+    explicit PostingList(Format format = Format::PLAIN)
+            : format_(format) {
+    }
+
+    // Appending documents in ascending order is amortized O(1)
+    void Add(DocumentOrdinal ordinal, double term_freq);
+
+    // Counts one more posting of a removed document. Such postings stay in the
+    // list, skipped by queries, until Compact drops them
+    void MarkRemoved() {
+        ++removed_count_;
+        UpdateLogDocumentFreq();
+    }
+
+    // Drops the postings mapped to REMOVED_ORDINAL and renumbers the others.
+    // The mapping has to keep the order of the ordinals that remain
+    void Compact(const std::vector<DocumentOrdinal>& new_ordinals);
+
+    // Valid until the list changes
+    PostingListView View() const noexcept;
+
+    bool Contains(DocumentOrdinal ordinal) const {
+        return View().Contains(ordinal);
+    }
+
+    template <typename Function>
+    void ForEach(Function function) const {
+        View().ForEach(function);
+    }
+
+    Format GetFormat() const noexcept {
+        return format_;
+    }
+
+    void SetFormat(Format format);
+
+    size_t GetDocumentFreq() const noexcept {
+        return size() - removed_count_;
+    }
+
+    size_t size() const noexcept {
+        return blocks_.size() * BLOCK_SIZE + postings_.size();
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+private:
+    using Block = PostingListView::Block;
+
+    Format format_;
+    // The whole list in PLAIN format, the unsealed tail in COMPRESSED one
+    std::vector<Posting> postings_;
+    std::vector<Block> blocks_;
+    std::vector<uint32_t> packed_deltas_;
+    // BLOCK_SIZE entries per block
+    std::vector<float> block_term_freqs_;
+    // Upper bounds for dynamic pruning, per block and for the whole list
+    std::vector<double> block_max_term_freqs_;
+    double max_term_freq_ = 0.0;
+    size_t removed_count_ = 0;
+    double log_document_freq_ = -std::numeric_limits<double>::infinity();
+
+    // Replaces the contents with sorted postings
+    void Assign(std::vector<Posting> postings);
+
+    void SealBlocks();
+
+    void UpdateLogDocumentFreq() {
+        log_document_freq_ = std::log(static_cast<double>(GetDocumentFreq()));
+    }
+
+    std::vector<Posting> ExtractPostings();
+};
+
+template <typename Function>
+void PostingListView::ForEach(Function function) const {
+    alignas(16) DocumentOrdinal ordinals[BLOCK_SIZE];
+    for (size_t block_index = 0; block_index < parts_.block_count; ++block_index) {
+        DecodeOrdinals(block_index, ordinals);
+        const float* term_freqs = parts_.block_term_freqs + block_index * BLOCK_SIZE;
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            function(ordinals[i], static_cast<double>(term_freqs[i]));
+        }
+    }
+    const Posting* const postings_end = parts_.postings + parts_.posting_count;
+    for (const Posting* posting = parts_.postings; posting != postings_end; ++posting) {
+        function(posting->ordinal, posting->term_freq);
+    }
+}
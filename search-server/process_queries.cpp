@@ -6,19 +6,31 @@
 #include "process_queries.h"
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    SearchServer::BatchResults batch = search_server.FindTopDocumentsBatch(queries);
     std::vector<std::vector<Document>> result(queries.size());
-    
-    std::transform(std::execution::par, queries.begin(), queries.end(), result.begin(), [&search_server](const std::string& str) {
-        return search_server.FindTopDocuments(str);
-    });
+    // The last query sharing an answer takes it over, the others get copies
+    std::vector<size_t> last_queries(batch.results.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        last_queries[batch.result_indexes[i]] = i;
+    }
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const size_t result_index = batch.result_indexes[i];
+        if (last_queries[result_index] == i) {
+            result[i] = std::move(batch.results[result_index]);
+        } else {
+            result[i] = batch.results[result_index];
+        }
+    }
     return result;
 }
 
-std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
-    std::vector<Document> result;
-    std::vector<std::vector<Document>> temp = ProcessQueries(search_server, queries);
-        for (auto v : temp) {
-                std::copy(v.begin(), v.end(), std::back_inserter(result));
-        }
-        return result;
-}
\ No newline at end of file
+JoinedDocuments::JoinedDocuments(SearchServer::BatchResults batch)
+        : batch_(std::move(batch)) {
+    for (const size_t result_index : batch_.result_indexes) {
+        size_ += batch_.results[result_index].size();
+    }
+}
+
+JoinedDocuments ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries) {
+    return JoinedDocuments(search_server.FindTopDocumentsBatch(queries));
+}
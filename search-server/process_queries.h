@@ -1,4 +1,5 @@
 #pragma once
+#include <iterator>
 #include <vector>
 #include "document.h"
 #include "search_server.h"
@@ -8,6 +9,89 @@ std::vector<std::vector<Document>> ProcessQueries(
         const SearchServer& search_server,
         const std::vector<std::string>& queries);
 
-std::vector<Document> ProcessQueriesJoined(
+// Documents found for all queries, in query order. Iterates the answers of the batch
+// in place, so repeated queries and the joined sequence cost no copies
+class JoinedDocuments {
+public:
+    class Iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = Document;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Document*;
+        using reference = const Document&;
+
+        Iterator(const SearchServer::BatchResults* batch, size_t query)
+                : batch_(batch)
+                , query_(query) {
+            SkipEmptyResults();
+        }
+
+        reference operator*() const {
+            return batch_->results[batch_->result_indexes[query_]][position_];
+        }
+
+        pointer operator->() const {
+            return &**this;
+        }
+
+        Iterator& operator++() {
+            ++position_;
+            SkipEmptyResults();
+            return *this;
+        }
+
+        Iterator operator++(int) {
+            Iterator previous = *this;
+            ++*this;
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const {
+            return query_ == other.query_ && position_ == other.position_;
+        }
+
+        bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+    private:
+        const SearchServer::BatchResults* batch_;
+        size_t query_;
+        size_t position_ = 0;
+
+        void SkipEmptyResults() {
+            while (query_ < batch_->result_indexes.size()
+                   && position_ == batch_->results[batch_->result_indexes[query_]].size()) {
+                ++query_;
+                position_ = 0;
+            }
+        }
+    };
+
+    explicit JoinedDocuments(SearchServer::BatchResults batch);
+
+    Iterator begin() const {
+        return {&batch_, 0};
+    }
+
+    Iterator end() const {
+        return {&batch_, batch_.result_indexes.size()};
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+private:
+    SearchServer::BatchResults batch_;
+    size_t size_ = 0;
+};
+
+JoinedDocuments ProcessQueriesJoined(
     const SearchServer& search_server,
-    const std::vector<std::string>& queries);
\ No newline at end of file
+    const std::vector<std::string>& queries);
@@ -0,0 +1,79 @@
+#include "query_result_cache.h"
+
+#include <algorithm>
+
+#include "hash_utils.h"
+
+QueryResultCache::QueryResultCache(size_t capacity)
+        : shard_capacity_(std::max<size_t>(1, (capacity + SHARD_COUNT - 1) / SHARD_COUNT))
+        , shards_(SHARD_COUNT) {
+}
+
+std::optional<std::vector<Document>> QueryResultCache::Find(const QueryCacheKey& key, uint64_t epoch) {
+    const uint64_t hash = ComputeHash(key);
+    Shard& shard = shards_[hash % SHARD_COUNT];
+    std::lock_guard guard(shard.mutex);
+    const auto it = shard.entry_by_hash.find(hash);
+    if (it == shard.entry_by_hash.end()) {
+        miss_count_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    const auto entry = it->second;
+    if (entry->epoch != epoch) {
+        // Epochs only grow, so the entry can never be used again
+        shard.entry_by_hash.erase(it);
+        shard.entries.erase(entry);
+        miss_count_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    if (!IsEntryOf(*entry, key)) {
+        miss_count_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, entry);
+    hit_count_.fetch_add(1, std::memory_order_relaxed);
+    return entry->documents;
+}
+
+void QueryResultCache::Insert(const QueryCacheKey& key, uint64_t epoch, const std::vector<Document>& documents) {
+    const uint64_t hash = ComputeHash(key);
+    Shard& shard = shards_[hash % SHARD_COUNT];
+    std::lock_guard guard(shard.mutex);
+    const auto it = shard.entry_by_hash.find(hash);
+    if (it != shard.entry_by_hash.end()) {
+        // Results of a newer epoch win, a colliding key takes the slot over
+        if (it->second->epoch > epoch) {
+            return;
+        }
+        shard.entries.erase(it->second);
+        shard.entry_by_hash.erase(it);
+    } else if (shard.entries.size() >= shard_capacity_) {
+        shard.entry_by_hash.erase(shard.entries.back().hash);
+        shard.entries.pop_back();
+    }
+    shard.entries.push_front({hash, epoch,
+                              std::vector<TermId>(key.plus_terms.begin(), key.plus_terms.end()),
+                              std::vector<TermId>(key.minus_terms.begin(), key.minus_terms.end()),
+                              key.filter, key.top_k, documents});
+    shard.entry_by_hash.emplace(hash, shard.entries.begin());
+}
+
+uint64_t QueryResultCache::ComputeHash(const QueryCacheKey& key) {
+    uint64_t hash = MixHash(key.filter ^ MixHash(key.top_k));
+    for (const TermId term : key.plus_terms) {
+        hash = MixHash(hash ^ term);
+    }
+    // Separates the plus words from the minus words
+    hash = MixHash(hash ^ key.plus_terms.size());
+    for (const TermId term : key.minus_terms) {
+        hash = MixHash(hash ^ term);
+    }
+    return hash;
+}
+
+bool QueryResultCache::IsEntryOf(const Entry& entry, const QueryCacheKey& key) {
+    return entry.filter == key.filter && entry.top_k == key.top_k
+           && std::equal(entry.plus_terms.begin(), entry.plus_terms.end(), key.plus_terms.begin(), key.plus_terms.end())
+           && std::equal(entry.minus_terms.begin(), entry.minus_terms.end(), key.minus_terms.begin(),
+                         key.minus_terms.end());
+}
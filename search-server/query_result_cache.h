@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "term_dictionary.h"
+
+// Term ids of a query kept in any contiguous container
+class TermIdRange {
+public:
+    TermIdRange(const TermId* first, const TermId* last)
+            : first_(first)
+            , last_(last) {
+    }
+
+    const TermId* begin() const noexcept {
+        return first_;
+    }
+
+    const TermId* end() const noexcept {
+        return last_;
+    }
+
+    size_t size() const noexcept {
+        return last_ - first_;
+    }
+
+private:
+    const TermId* first_;
+    const TermId* last_;
+};
+
+// A normalized query: sorted unique term ids of the plus and minus words,
+// the document filter and the number of requested results
+struct QueryCacheKey {
+    TermIdRange plus_terms;
+    TermIdRange minus_terms;
+    uint32_t filter;
+    size_t top_k;
+};
+
+// Bounded LRU cache of query results, safe to use from several threads. Every result
+// is stored with the index epoch it was computed at, results of older epochs are
+// never returned and are dropped when met, so a change of the index needs no flush
+class QueryResultCache {
+public:
+    // capacity is the total number of cached results, split between shards with locks of their own
+    explicit QueryResultCache(size_t capacity);
+
+    // Returns nothing unless the result was stored for the same key at the same epoch
+    std::optional<std::vector<Document>> Find(const QueryCacheKey& key, uint64_t epoch);
+
+    void Insert(const QueryCacheKey& key, uint64_t epoch, const std::vector<Document>& documents);
+
+    // The capacity given, rounded up to a multiple of the shard count
+    size_t GetCapacity() const noexcept {
+        return shard_capacity_ * SHARD_COUNT;
+    }
+
+    size_t GetHitCount() const noexcept {
+        return hit_count_.load(std::memory_order_relaxed);
+    }
+
+    size_t GetMissCount() const noexcept {
+        return miss_count_.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t SHARD_COUNT = 16;
+
+    struct Entry {
+        uint64_t hash;
+        uint64_t epoch;
+        std::vector<TermId> plus_terms;
+        std::vector<TermId> minus_terms;
+        uint32_t filter;
+        size_t top_k;
+        std::vector<Document> documents;
+    };
+
+    // Entries are kept from the most to the least recently used one. The hash
+    // stands for the key in the lookup table, Entry holds the key to check it
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<uint64_t, std::list<Entry>::iterator> entry_by_hash;
+    };
+
+    size_t shard_capacity_;
+    std::vector<Shard> shards_;
+    std::atomic<size_t> hit_count_ = 0;
+    std::atomic<size_t> miss_count_ = 0;
+
+    static uint64_t ComputeHash(const QueryCacheKey& key);
+
+    static bool IsEntryOf(const Entry& entry, const QueryCacheKey& key);
+};
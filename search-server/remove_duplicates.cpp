@@ -1,34 +1,246 @@
 // в качестве заготовки кода используйте последнюю версию своей поисковой системы
 #include "remove_duplicates.h"
 
-#include <set>
-#include <string>
-#include <iostream>
-#include <vector>
-
-using namespace std::literals;
-
-void RemoveDuplicates(SearchServer& search_server) {
-    std::set<int> ids_to_delete;
-    for (auto first_it = search_server.begin(); first_it != search_server.end(); ++first_it) {
-        if (!ids_to_delete.count(*first_it)) {
-            for (auto second_it = std::next(first_it); second_it != search_server.end(); ++second_it) {
-                if (!ids_to_delete.count(*second_it)) {
-                    std::set<std::string> first_document_content, second_document_content;
-                    for (const auto& [word, _] : search_server.GetWordFrequencies(*first_it)) {
-                        first_document_content.insert(word);
-                    }
-                    for (const auto& [word, _] : search_server.GetWordFrequencies(*second_it)) {
-                        second_document_content.insert(word);
-                    }
-                    if (first_document_content == second_document_content) {
-                        ids_to_delete.insert(*second_it);
-                    }
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include "hash_utils.h"
+
+namespace {
+
+// Terms are sorted by id, so equal word sets give equal sequences and equal fingerprints
+uint64_t ComputeFingerprint(TermFrequencyRange terms) {
+    uint64_t fingerprint = MixHash(terms.size());
+    for (const TermFrequency& entry : terms) {
+        fingerprint = MixHash(fingerprint ^ entry.term);
+    }
+    return fingerprint;
+}
+
+bool HaveSameTerms(TermFrequencyRange lhs, TermFrequencyRange rhs) {
+    return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                      [](const TermFrequency& lhs_entry, const TermFrequency& rhs_entry) {
+                          return lhs_entry.term == rhs_entry.term;
+                      });
+}
+
+double ComputeJaccardSimilarity(TermFrequencyRange lhs, TermFrequencyRange rhs) {
+    if (lhs.empty() && rhs.empty()) {
+        return 1.0;
+    }
+    size_t common_count = 0;
+    auto lhs_it = lhs.begin();
+    auto rhs_it = rhs.begin();
+    while (lhs_it != lhs.end() && rhs_it != rhs.end()) {
+        if (lhs_it->term < rhs_it->term) {
+            ++lhs_it;
+        } else if (rhs_it->term < lhs_it->term) {
+            ++rhs_it;
+        } else {
+            ++common_count;
+            ++lhs_it;
+            ++rhs_it;
+        }
+    }
+    return static_cast<double>(common_count) / static_cast<double>(lhs.size() + rhs.size() - common_count);
+}
+
+// Marks every document whose word set equals the one of a document with a lower index
+void MarkExactDuplicates(const std::vector<TermFrequencyRange>& documents, std::vector<char>& is_duplicate) {
+    std::vector<uint64_t> fingerprints(documents.size());
+    std::transform(std::execution::par, documents.begin(), documents.end(), fingerprints.begin(), ComputeFingerprint);
+
+    std::vector<uint32_t> order(documents.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(std::execution::par, order.begin(), order.end(), [&fingerprints](uint32_t lhs, uint32_t rhs) {
+        return std::pair(fingerprints[lhs], lhs) < std::pair(fingerprints[rhs], rhs);
+    });
+
+    // Documents of a group come in ascending order, so the first one of every word set is kept
+    std::vector<uint32_t> kept;
+    for (size_t group_begin = 0; group_begin < order.size();) {
+        size_t group_end = group_begin + 1;
+        while (group_end < order.size() && fingerprints[order[group_end]] == fingerprints[order[group_begin]]) {
+            ++group_end;
+        }
+        kept.clear();
+        for (size_t i = group_begin; i < group_end; ++i) {
+            const uint32_t document = order[i];
+            // Different word sets rarely share a fingerprint, so the list of kept documents stays short
+            const bool is_copy = std::any_of(kept.begin(), kept.end(), [&](uint32_t kept_document) {
+                return HaveSameTerms(documents[kept_document], documents[document]);
+            });
+            if (is_copy) {
+                is_duplicate[document] = true;
+            } else {
+                kept.push_back(document);
+            }
+        }
+        group_begin = group_end;
+    }
+}
+
+// MinHash signatures of the documents, signature_size values per document
+std::vector<uint64_t> ComputeSignatures(const std::vector<TermFrequencyRange>& documents, size_t signature_size) {
+    std::vector<uint64_t> seeds(signature_size);
+    for (size_t i = 0; i < signature_size; ++i) {
+        seeds[i] = MixHash(i + 1);
+    }
+    std::vector<uint64_t> signatures(documents.size() * signature_size);
+    std::vector<uint32_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](uint32_t index) {
+        uint64_t* signature = signatures.data() + index * signature_size;
+        std::fill(signature, signature + signature_size, std::numeric_limits<uint64_t>::max());
+        for (const TermFrequency& entry : documents[index]) {
+            for (size_t i = 0; i < signature_size; ++i) {
+                signature[i] = std::min(signature[i], MixHash(seeds[i] ^ entry.term));
+            }
+        }
+    });
+    return signatures;
+}
+
+// Documents with similarity s share a bucket with probability 1 - (1 - s^rows)^bands
+size_t ChooseBandCount(double similarity_threshold, size_t signature_size) {
+    const double min_recall = 0.95;
+    for (size_t rows_per_band = signature_size; rows_per_band > 1; --rows_per_band) {
+        const size_t band_count = signature_size / rows_per_band;
+        const double recall = 1.0 - std::pow(1.0 - std::pow(similarity_threshold, rows_per_band), band_count);
+        if (recall >= min_recall) {
+            return band_count;
+        }
+    }
+    return signature_size;
+}
+
+// Pairs (later, earlier) of documents that share at least one LSH bucket, sorted and unique
+std::vector<std::pair<uint32_t, uint32_t>> FindCandidatePairs(const std::vector<TermFrequencyRange>& documents,
+                                                              const std::vector<uint64_t>& signatures,
+                                                              double similarity_threshold,
+                                                              size_t signature_size, size_t band_count) {
+    const size_t rows_per_band = signature_size / band_count;
+    std::vector<std::pair<uint64_t, uint32_t>> buckets(documents.size() * band_count);
+    std::vector<uint32_t> indexes(documents.size());
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(std::execution::par, indexes.begin(), indexes.end(), [&](uint32_t index) {
+        const uint64_t* signature = signatures.data() + index * signature_size;
+        for (size_t band = 0; band < band_count; ++band) {
+            uint64_t bucket = MixHash(band + 1);
+            for (size_t row = 0; row < rows_per_band; ++row) {
+                bucket = MixHash(bucket ^ signature[band * rows_per_band + row]);
+            }
+            buckets[index * band_count + band] = {bucket, index};
+        }
+    });
+    std::sort(std::execution::par, buckets.begin(), buckets.end());
+
+    std::vector<std::pair<uint32_t, uint32_t>> pairs;
+    for (size_t bucket_begin = 0; bucket_begin < buckets.size();) {
+        size_t bucket_end = bucket_begin + 1;
+        while (bucket_end < buckets.size() && buckets[bucket_end].first == buckets[bucket_begin].first) {
+            ++bucket_end;
+        }
+        for (size_t later = bucket_begin + 1; later < bucket_end; ++later) {
+            for (size_t earlier = bucket_begin; earlier < later; ++earlier) {
+                const uint32_t later_index = buckets[later].second;
+                const uint32_t earlier_index = buckets[earlier].second;
+                // Bands of one document may collide on the bucket hash. The similarity
+                // is at most the ratio of the word counts, which rules out most pairs early
+                // minmax of two arguments returns references, which must not outlive the sizes
+                const size_t later_size = documents[later_index].size();
+                const size_t earlier_size = documents[earlier_index].size();
+                const auto [smaller, larger] = std::minmax(later_size, earlier_size);
+                if (later_index != earlier_index && smaller >= similarity_threshold * larger) {
+                    pairs.emplace_back(later_index, earlier_index);
                 }
             }
         }
+        bucket_begin = bucket_end;
+    }
+    std::sort(std::execution::par, pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    return pairs;
+}
+
+// Marks every document similar to a kept document with a lower index
+void MarkNearDuplicates(const std::vector<TermFrequencyRange>& documents, const DuplicateSearchOptions& options,
+                        std::vector<char>& is_duplicate) {
+    if (options.signature_size == 0 || options.signature_size < options.band_count) {
+        throw std::invalid_argument("Band count must not exceed the positive signature size");
+    }
+    const size_t band_count = options.band_count != 0
+                              ? options.band_count
+                              : ChooseBandCount(options.similarity_threshold, options.signature_size);
+    // Copies of a document are already marked and can not be kept, so they can not remove anything either
+    std::vector<uint32_t> originals;
+    for (uint32_t index = 0; index < documents.size(); ++index) {
+        if (!is_duplicate[index]) {
+            originals.push_back(index);
+        }
     }
-    for (int id : ids_to_delete) {
+    std::vector<TermFrequencyRange> original_documents(originals.size());
+    std::transform(originals.begin(), originals.end(), original_documents.begin(), [&documents](uint32_t index) {
+        return documents[index];
+    });
+
+    const std::vector<uint64_t> signatures = ComputeSignatures(original_documents, options.signature_size);
+    const auto pairs = FindCandidatePairs(original_documents, signatures, options.similarity_threshold,
+                                          options.signature_size, band_count);
+
+    std::vector<char> is_similar(pairs.size());
+    std::transform(std::execution::par, pairs.begin(), pairs.end(), is_similar.begin(),
+                   [&](const std::pair<uint32_t, uint32_t>& pair) {
+                       return ComputeJaccardSimilarity(original_documents[pair.first], original_documents[pair.second])
+                              >= options.similarity_threshold;
+                   });
+
+    // Pairs are ordered by the later document, so whether the earlier one is kept is already known
+    for (size_t i = 0; i < pairs.size(); ++i) {
+        const uint32_t later = originals[pairs[i].first];
+        const uint32_t earlier = originals[pairs[i].second];
+        if (is_similar[i] && !is_duplicate[earlier]) {
+            is_duplicate[later] = true;
+        }
+    }
+}
+
+} // namespace
+
+std::vector<int> FindDuplicates(const SearchServer& search_server, const DuplicateSearchOptions& options) {
+    if (!(options.similarity_threshold > 0.0 && options.similarity_threshold <= 1.0)) {
+        throw std::invalid_argument("Similarity threshold must be in (0, 1]");
+    }
+    // Ascending ids, so a lower index means a lower id
+    const std::vector<int> document_ids(search_server.begin(), search_server.end());
+    std::vector<TermFrequencyRange> documents(document_ids.size());
+    std::transform(document_ids.begin(), document_ids.end(), documents.begin(), [&search_server](int document_id) {
+        return search_server.GetWordFrequencies(document_id).GetTermFrequencies();
+    });
+
+    std::vector<char> is_duplicate(documents.size(), false);
+    MarkExactDuplicates(documents, is_duplicate);
+    if (options.similarity_threshold < 1.0) {
+        MarkNearDuplicates(documents, options, is_duplicate);
+    }
+
+    std::vector<int> duplicates;
+    for (size_t i = 0; i < document_ids.size(); ++i) {
+        if (is_duplicate[i]) {
+            duplicates.push_back(document_ids[i]);
+        }
+    }
+    return duplicates;
+}
+
+void RemoveDuplicates(SearchServer& search_server, const DuplicateSearchOptions& options) {
+    for (int id : FindDuplicates(search_server, options)) {
         search_server.RemoveDocument(id);
     }
-}
\ No newline at end of file
+}
@@ -1,5 +1,26 @@
 // в качестве заготовки кода используйте последнюю версию своей поисковой системы
 #pragma once
+#include <cstddef>
+#include <vector>
+
 #include "search_server.h"
 
-void RemoveDuplicates(SearchServer& search_server);
\ No newline at end of file
+struct DuplicateSearchOptions {
+    // Documents whose word sets have at least this Jaccard similarity are duplicates.
+    // 1.0 finds documents with equal word sets only, lower values turn on
+    // the MinHash near-duplicate search
+    double similarity_threshold = 1.0;
+    // MinHash signature length, split into band_count bands for the LSH buckets.
+    // More bands find more candidate pairs at lower similarities. Zero band count
+    // takes the fewest bands that still find 95% of the pairs at the threshold
+    size_t signature_size = 128;
+    size_t band_count = 0;
+};
+
+// Ids of the documents that duplicate a document with a lower id which is kept,
+// in ascending order. Candidates are grouped by hash and every reported pair
+// is verified on the exact word sets
+std::vector<int> FindDuplicates(const SearchServer& search_server, const DuplicateSearchOptions& options = {});
+
+// Removes the documents FindDuplicates reports, the one with the lowest id is kept
+void RemoveDuplicates(SearchServer& search_server, const DuplicateSearchOptions& options = {});
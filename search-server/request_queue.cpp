@@ -1,18 +1,26 @@
-//Вставьте сюда своё решение из урока «‎Очередь запросов».‎ 
-#include "request_queue.h" 
- 
- 
- 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) { 
-    const auto result = search_server_.FindTopDocuments(raw_query, status); 
-        return SetterToAddRequest(result); 
-} 
- 
-std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) { 
-    const auto result = search_server_.FindTopDocuments(raw_query); 
-        return SetterToAddRequest(result); 
-} 
- 
-int RequestQueue::GetNoResultRequests() const { 
-    return no_result_request_; 
-} 
\ No newline at end of file
+#include "request_queue.h"
+
+std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentStatus status) {
+    return RunRequest([&] {
+        return search_server_.FindTopDocuments(raw_query, status);
+    });
+}
+
+std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query) {
+    return RunRequest([&] {
+        return search_server_.FindTopDocuments(raw_query);
+    });
+}
+
+std::vector<Document> RequestQueue::SetterToAddRequest(const std::vector<Document>& result) {
+    statistics_.Record(result.size(), std::chrono::nanoseconds(0));
+    return result;
+}
+
+int RequestQueue::GetNoResultRequests() const {
+    return static_cast<int>(statistics_.GetStatistics().no_result_count);
+}
+
+RequestWindowStatistics RequestQueue::GetStatistics() const {
+    return statistics_.GetStatistics();
+}
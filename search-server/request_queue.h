@@ -1,63 +1,63 @@
-//Вставьте сюда своё решение из урока «‎Очередь запросов».‎ 
 #pragma once
 
-#include <deque>
+#include <chrono>
+#include <string>
+#include <vector>
 
+#include "request_statistics.h"
 #include "search_server.h"
 
+// Runs searches and keeps statistics of the requests of a sliding window, by default
+// the last day. Safe to use from several threads, the statistics take no lock.
+// The window is wall-clock time now: it used to be the last 1440 requests, each
+// counted as one minute, whatever time had actually passed between them
 class RequestQueue {
 public:
-    explicit RequestQueue(const SearchServer& search_server) :search_server_(search_server), no_result_request_(0), current_time_(0) {
-        // напишите реализацию
+    explicit RequestQueue(const SearchServer& search_server,
+                          std::chrono::seconds bucket_width = std::chrono::minutes(1), size_t bucket_count = 1440)
+            : search_server_(search_server)
+            , statistics_(bucket_width, bucket_count) {
     }
 
-    std::vector<Document> SetterToAddRequest(const std::vector<Document>& result){
-        AddRequest(result.size());
-        return result;
-    }
-
-    // сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
+    // Wrappers of the searches of the server that record every request
     template <typename DocumentPredicate>
-    std::vector<Document> AddFindRequest(const std::string& , DocumentPredicate);
+    std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate);
 
     std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
 
     std::vector<Document> AddFindRequest(const std::string& raw_query);
 
-    int GetNoResultRequests() const ;
-private:
-    struct QueryResult {
-        // определите, что должно быть в структуре
-        int result_;
-        uint64_t timestamp;
-    };
+    // Records a search run elsewhere, with no latency, and returns its result.
+    // Kept for old callers, new ones call AddFindRequest
+    [[deprecated("Use AddFindRequest")]]
+    std::vector<Document> SetterToAddRequest(const std::vector<Document>& result);
+
+    // Requests of the window that found nothing. Requests older than the window are
+    // dropped even when fewer than 1440 requests came after them
+    int GetNoResultRequests() const;
+
+    RequestWindowStatistics GetStatistics() const;
 
+private:
     const SearchServer& search_server_;
-    int no_result_request_;
-    uint64_t current_time_;
-    std::deque<QueryResult> requests_;
-    const static int sec_in_day_ = 1440;
-    // возможно, здесь вам понадобится что-то ещё
-    void AddRequest(int results) {
-        ++current_time_;
-        while (!requests_.empty() && sec_in_day_ <= current_time_ - requests_.front().timestamp){
-            if(requests_.front().result_ == 0)
-            {
-                --no_result_request_;
-            }
-            requests_.pop_front();
-        }
-
-        requests_.push_back({results, current_time_});
-        if (results == 0) {
-            ++no_result_request_;
-        }
-    }
+    RequestStatistics statistics_;
+
+    template <typename Search>
+    std::vector<Document> RunRequest(Search search);
 };
 
+template <typename Search>
+std::vector<Document> RequestQueue::RunRequest(Search search) {
+    const auto start = RequestStatistics::Clock::now();
+    std::vector<Document> result = search();
+    const auto finish = RequestStatistics::Clock::now();
+    statistics_.Record(result.size(), finish - start, finish);
+    return result;
+}
+
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-    // напишите реализацию
-    const auto result = search_server_.FindTopDocuments(raw_query, document_predicate);
-    return SetterToAddRequest(result);
-}
\ No newline at end of file
+    return RunRequest([&] {
+        return search_server_.FindTopDocuments(raw_query, document_predicate);
+    });
+}
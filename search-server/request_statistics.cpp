@@ -0,0 +1,108 @@
+#include "request_statistics.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+// Bucket never used
+const int64_t NO_TICK = std::numeric_limits<int64_t>::min();
+// Bucket being cleared for a new tick by one of the recording threads
+const int64_t RESETTING_TICK = NO_TICK + 1;
+
+} // namespace
+
+RequestStatistics::RequestStatistics(std::chrono::seconds bucket_width, size_t bucket_count)
+        : bucket_width_(bucket_width)
+        , bucket_count_(bucket_count) {
+    if (bucket_width_.count() <= 0 || bucket_count_ == 0) {
+        throw std::invalid_argument("Statistics window must have a positive width and bucket count");
+    }
+    buckets_ = std::make_unique<Bucket[]>(bucket_count_);
+    for (size_t index = 0; index < bucket_count_; ++index) {
+        Bucket& bucket = buckets_[index];
+        bucket.tick.store(NO_TICK, std::memory_order_relaxed);
+        bucket.request_count.store(0, std::memory_order_relaxed);
+        bucket.no_result_count.store(0, std::memory_order_relaxed);
+        bucket.total_latency_ns.store(0, std::memory_order_relaxed);
+        bucket.max_latency_ns.store(0, std::memory_order_relaxed);
+    }
+}
+
+void RequestStatistics::Record(size_t result_count, std::chrono::nanoseconds latency) {
+    Record(result_count, latency, Clock::now());
+}
+
+void RequestStatistics::Record(size_t result_count, std::chrono::nanoseconds latency, Clock::time_point now) {
+    const int64_t tick = GetTick(now);
+    Bucket& bucket = buckets_[static_cast<size_t>(tick) % bucket_count_];
+    int64_t bucket_tick = bucket.tick.load(std::memory_order_acquire);
+    while (bucket_tick != tick) {
+        if (bucket_tick == RESETTING_TICK) {
+            // Another thread is clearing the bucket, which happens once per bucket width
+            std::this_thread::yield();
+            bucket_tick = bucket.tick.load(std::memory_order_acquire);
+        } else if (bucket_tick > tick) {
+            // The thread was delayed for a whole window and the bucket has moved on
+            return;
+        } else if (bucket.tick.compare_exchange_weak(bucket_tick, RESETTING_TICK, std::memory_order_acquire)) {
+            // Readers must see the mark before any counter is cleared
+            std::atomic_thread_fence(std::memory_order_release);
+            bucket.request_count.store(0, std::memory_order_relaxed);
+            bucket.no_result_count.store(0, std::memory_order_relaxed);
+            bucket.total_latency_ns.store(0, std::memory_order_relaxed);
+            bucket.max_latency_ns.store(0, std::memory_order_relaxed);
+            bucket.tick.store(tick, std::memory_order_release);
+            break;
+        }
+    }
+
+    const auto latency_ns = static_cast<uint64_t>(std::max<int64_t>(0, latency.count()));
+    bucket.request_count.fetch_add(1, std::memory_order_relaxed);
+    if (result_count == 0) {
+        bucket.no_result_count.fetch_add(1, std::memory_order_relaxed);
+    }
+    bucket.total_latency_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+    uint64_t max_latency_ns = bucket.max_latency_ns.load(std::memory_order_relaxed);
+    while (latency_ns > max_latency_ns
+           && !bucket.max_latency_ns.compare_exchange_weak(max_latency_ns, latency_ns, std::memory_order_relaxed)) {
+    }
+}
+
+RequestWindowStatistics RequestStatistics::GetStatistics() const {
+    return GetStatistics(Clock::now());
+}
+
+RequestWindowStatistics RequestStatistics::GetStatistics(Clock::time_point now) const {
+    const int64_t tick = GetTick(now);
+    const int64_t oldest_tick = tick - static_cast<int64_t>(bucket_count_) + 1;
+    RequestWindowStatistics statistics;
+    for (size_t index = 0; index < bucket_count_; ++index) {
+        const Bucket& bucket = buckets_[index];
+        const int64_t bucket_tick = bucket.tick.load(std::memory_order_acquire);
+        if (bucket_tick < oldest_tick || bucket_tick > tick) {
+            continue;
+        }
+        RequestWindowStatistics bucket_statistics;
+        bucket_statistics.request_count = bucket.request_count.load(std::memory_order_relaxed);
+        bucket_statistics.no_result_count = bucket.no_result_count.load(std::memory_order_relaxed);
+        bucket_statistics.total_latency_ns = bucket.total_latency_ns.load(std::memory_order_relaxed);
+        bucket_statistics.max_latency_ns = bucket.max_latency_ns.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // A bucket cleared while being read belongs to a newer tick, its counters are dropped
+        if (bucket.tick.load(std::memory_order_acquire) != bucket_tick) {
+            continue;
+        }
+        statistics.request_count += bucket_statistics.request_count;
+        statistics.no_result_count += bucket_statistics.no_result_count;
+        statistics.total_latency_ns += bucket_statistics.total_latency_ns;
+        statistics.max_latency_ns = std::max(statistics.max_latency_ns, bucket_statistics.max_latency_ns);
+    }
+    return statistics;
+}
+
+int64_t RequestStatistics::GetTick(Clock::time_point now) const {
+    return std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count() / bucket_width_.count();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Totals of the requests that fell into the window
+struct RequestWindowStatistics {
+    uint64_t request_count = 0;
+    uint64_t no_result_count = 0;
+    uint64_t total_latency_ns = 0;
+    uint64_t max_latency_ns = 0;
+};
+
+// Request statistics over a sliding window of wall-clock time, safe to update from any
+// number of threads. The window is a ring of fixed-width buckets updated with atomics,
+// so the memory stays the same whatever the request rate, and recording takes no lock.
+// The oldest bucket slides out as a whole, the window is exact up to one bucket width
+class RequestStatistics {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // By default a day of minutes
+    explicit RequestStatistics(std::chrono::seconds bucket_width = std::chrono::minutes(1),
+                               size_t bucket_count = 1440);
+
+    void Record(size_t result_count, std::chrono::nanoseconds latency);
+    void Record(size_t result_count, std::chrono::nanoseconds latency, Clock::time_point now);
+
+    RequestWindowStatistics GetStatistics() const;
+    RequestWindowStatistics GetStatistics(Clock::time_point now) const;
+
+    std::chrono::seconds GetWindow() const noexcept {
+        return bucket_width_ * static_cast<int64_t>(bucket_count_);
+    }
+
+private:
+    // A cache line each, so that threads recording into neighbouring buckets do not collide
+    struct alignas(64) Bucket {
+        // Number of bucket widths since the clock epoch the counters belong to
+        std::atomic<int64_t> tick;
+        std::atomic<uint64_t> request_count;
+        std::atomic<uint64_t> no_result_count;
+        std::atomic<uint64_t> total_latency_ns;
+        std::atomic<uint64_t> max_latency_ns;
+    };
+
+    std::chrono::seconds bucket_width_;
+    size_t bucket_count_;
+    std::unique_ptr<Bucket[]> buckets_;
+
+    int64_t GetTick(Clock::time_point now) const;
+};
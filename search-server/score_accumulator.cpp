@@ -0,0 +1,39 @@
+#include "score_accumulator.h"
+
+namespace {
+
+// Idle accumulators of the thread. A nested search on the same thread
+// takes another one instead of clobbering the accumulator in use
+thread_local std::vector<std::unique_ptr<ScoreAccumulator>> free_accumulators;
+
+} // namespace
+
+ScoreAccumulator::Lease::Lease(size_t document_count) {
+    if (free_accumulators.empty()) {
+        accumulator_ = std::make_unique<ScoreAccumulator>();
+    } else {
+        accumulator_ = std::move(free_accumulators.back());
+        free_accumulators.pop_back();
+    }
+    accumulator_->Reserve(document_count);
+}
+
+ScoreAccumulator::Lease::~Lease() {
+    accumulator_->Clear();
+    free_accumulators.push_back(std::move(accumulator_));
+}
+
+void ScoreAccumulator::Reserve(size_t document_count) {
+    if (scores_.size() < document_count) {
+        scores_.resize(document_count, 0.0);
+        states_.resize(document_count, State::EMPTY);
+    }
+}
+
+void ScoreAccumulator::Clear() {
+    for (const DocumentOrdinal ordinal : touched_) {
+        scores_[ordinal] = 0.0;
+        states_[ordinal] = State::EMPTY;
+    }
+    touched_.clear();
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "posting_list.h"
+
+// Dense relevance accumulator indexed by document ordinal. Only the touched
+// entries are cleared between queries, so reusing it costs O(matched documents)
+class ScoreAccumulator {
+public:
+    // Accumulator borrowed from the pool of the current thread, returned cleared
+    class Lease {
+    public:
+        explicit Lease(size_t document_count);
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease();
+
+        ScoreAccumulator* operator->() const noexcept {
+            return accumulator_.get();
+        }
+
+        ScoreAccumulator& operator*() const noexcept {
+            return *accumulator_;
+        }
+
+    private:
+        std::unique_ptr<ScoreAccumulator> accumulator_;
+    };
+
+    void Add(DocumentOrdinal ordinal, double score) {
+        if (states_[ordinal] == State::EMPTY) {
+            states_[ordinal] = State::SCORED;
+            touched_.push_back(ordinal);
+        }
+        if (states_[ordinal] == State::SCORED) {
+            scores_[ordinal] += score;
+        }
+    }
+
+    // Excluded documents ignore further scores and are never reported
+    void Exclude(DocumentOrdinal ordinal) {
+        if (states_[ordinal] == State::EMPTY) {
+            touched_.push_back(ordinal);
+        }
+        states_[ordinal] = State::EXCLUDED;
+    }
+
+    bool IsExcluded(DocumentOrdinal ordinal) const {
+        return states_[ordinal] == State::EXCLUDED;
+    }
+
+    template <typename Function>
+    void ForEachScore(Function function) const {
+        for (const DocumentOrdinal ordinal : touched_) {
+            if (states_[ordinal] == State::SCORED) {
+                function(ordinal, scores_[ordinal]);
+            }
+        }
+    }
+
+private:
+    enum class State : uint8_t {
+        EMPTY,
+        SCORED,
+        EXCLUDED,
+    };
+
+    std::vector<double> scores_;
+    std::vector<State> states_;
+    std::vector<DocumentOrdinal> touched_;
+
+    void Reserve(size_t document_count);
+    void Clear();
+};
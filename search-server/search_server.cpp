@@ -1,7 +1,201 @@
 // в качестве заготовки кода используйте последнюю версию своей поисковой системы
 #include "search_server.h"
+#include <atomic>
+#include <exception>
 #include <future>
 #include <numeric>
+#include <tuple>
+
+#include "snapshot_file.h"
+
+namespace {
+
+// Reused by every tokenization on the thread
+thread_local std::vector<std::string_view> word_buffer;
+
+// Bumped whenever the layout of any section changes
+const uint32_t SNAPSHOT_VERSION = 1;
+
+enum SnapshotSection : uint32_t {
+    STOP_WORD_TEXT,
+    STOP_WORD_OFFSETS,
+    TERM_TEXT,
+    TERM_OFFSETS,
+    // Term ids in the alphabetical order of their words
+    SORTED_TERMS,
+    POSTING_LISTS,
+    POSTINGS,
+    POSTING_BLOCKS,
+    PACKED_DELTAS,
+    BLOCK_TERM_FREQS,
+    BLOCK_MAX_TERM_FREQS,
+    DOCUMENTS,
+    // Sorted by document id
+    DOCUMENT_IDS,
+    DOCUMENT_TEXT,
+    DOCUMENT_TEXT_OFFSETS,
+    FORWARD_OFFSETS,
+    FORWARD_ENTRIES,
+};
+
+// Ranges of one posting list in the posting sections, indexed by TermId
+struct PostingListRecord {
+    uint64_t postings_offset;
+    uint64_t posting_count;
+    uint64_t blocks_offset;
+    uint64_t block_count;
+    uint64_t packed_deltas_offset;
+    uint64_t block_term_freqs_offset;
+    uint64_t block_max_term_freqs_offset;
+    double max_term_freq;
+    uint64_t document_freq;
+    double log_document_freq;
+};
+
+struct DocumentIdOrdinal {
+    int id;
+    DocumentOrdinal ordinal;
+};
+
+// String i takes text[offsets[i], offsets[i + 1])
+void WriteStrings(SnapshotWriter& writer, uint32_t text_section, uint32_t offsets_section,
+                  const std::vector<std::string_view>& strings) {
+    std::vector<char> text;
+    std::vector<uint64_t> offsets = {0};
+    for (const std::string_view str : strings) {
+        text.insert(text.end(), str.begin(), str.end());
+        offsets.push_back(text.size());
+    }
+    writer.WriteSection(text_section, text);
+    writer.WriteSection(offsets_section, offsets);
+}
+
+std::string_view GetString(const SnapshotArray<char>& text, const SnapshotArray<uint64_t>& offsets, size_t index) {
+    return {text.data() + offsets[index], static_cast<size_t>(offsets[index + 1] - offsets[index])};
+}
+
+template <typename T>
+void Append(std::vector<T>& values, const T* data, size_t count) {
+    values.insert(values.end(), data, data + count);
+}
+
+// Whether [offset, offset + count) lies within an array of the given size, free of overflow
+bool FitsIn(uint64_t offset, uint64_t count, size_t size) {
+    return offset <= size && count <= size - offset;
+}
+
+// Offsets of count ranges written by WriteStrings or the forward index: ascending and
+// within the array they point into
+bool AreValidOffsets(const SnapshotArray<uint64_t>& offsets, size_t count, size_t array_size) {
+    if (offsets.size() != count + 1 || offsets[count] > array_size) {
+        return false;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (offsets[i] > offsets[i + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+struct SearchServer::MappedIndex {
+    MappedSnapshot snapshot;
+    std::vector<std::string_view> stop_words;
+    SnapshotArray<char> term_text;
+    SnapshotArray<uint64_t> term_offsets;
+    SnapshotArray<TermId> sorted_terms;
+    SnapshotArray<PostingListRecord> posting_lists;
+    SnapshotArray<PostingListView::Posting> postings;
+    SnapshotArray<PostingListView::Block> posting_blocks;
+    SnapshotArray<uint32_t> packed_deltas;
+    SnapshotArray<float> block_term_freqs;
+    SnapshotArray<double> block_max_term_freqs;
+    SnapshotArray<DocumentData> documents;
+    SnapshotArray<DocumentIdOrdinal> document_ids;
+    SnapshotArray<char> document_text;
+    SnapshotArray<uint64_t> document_text_offsets;
+    SnapshotArray<uint64_t> forward_offsets;
+    SnapshotArray<TermFrequency> forward_entries;
+
+    explicit MappedIndex(const std::string& path)
+            : snapshot(path, SNAPSHOT_VERSION)
+            , term_text(snapshot.GetSection<char>(TERM_TEXT))
+            , term_offsets(snapshot.GetSection<uint64_t>(TERM_OFFSETS))
+            , sorted_terms(snapshot.GetSection<TermId>(SORTED_TERMS))
+            , posting_lists(snapshot.GetSection<PostingListRecord>(POSTING_LISTS))
+            , postings(snapshot.GetSection<PostingListView::Posting>(POSTINGS))
+            , posting_blocks(snapshot.GetSection<PostingListView::Block>(POSTING_BLOCKS))
+            , packed_deltas(snapshot.GetSection<uint32_t>(PACKED_DELTAS))
+            , block_term_freqs(snapshot.GetSection<float>(BLOCK_TERM_FREQS))
+            , block_max_term_freqs(snapshot.GetSection<double>(BLOCK_MAX_TERM_FREQS))
+            , documents(snapshot.GetSection<DocumentData>(DOCUMENTS))
+            , document_ids(snapshot.GetSection<DocumentIdOrdinal>(DOCUMENT_IDS))
+            , document_text(snapshot.GetSection<char>(DOCUMENT_TEXT))
+            , document_text_offsets(snapshot.GetSection<uint64_t>(DOCUMENT_TEXT_OFFSETS))
+            , forward_offsets(snapshot.GetSection<uint64_t>(FORWARD_OFFSETS))
+            , forward_entries(snapshot.GetSection<TermFrequency>(FORWARD_ENTRIES)) {
+        const auto stop_word_text = snapshot.GetSection<char>(STOP_WORD_TEXT);
+        const auto stop_word_offsets = snapshot.GetSection<uint64_t>(STOP_WORD_OFFSETS);
+        const size_t stop_word_count = stop_word_offsets.size() > 0 ? stop_word_offsets.size() - 1 : 0;
+        if (!AreValidOffsets(stop_word_offsets, stop_word_count, stop_word_text.size()) || !HasValidRanges()) {
+            throw std::runtime_error("Corrupted snapshot file " + path);
+        }
+        for (size_t i = 0; i < stop_word_count; ++i) {
+            stop_words.push_back(GetString(stop_word_text, stop_word_offsets, i));
+        }
+    }
+
+    // Checks every offset and range, which takes reading the small sections that hold
+    // them. The postings and forward entries themselves are trusted, checking them
+    // would fault in the whole file
+    bool HasValidRanges() const {
+        const size_t term_count = posting_lists.size();
+        const size_t document_count = documents.size();
+        if (!AreValidOffsets(term_offsets, term_count, term_text.size()) || sorted_terms.size() != term_count
+            || document_ids.size() != document_count
+            || !AreValidOffsets(document_text_offsets, document_count, document_text.size())
+            || !AreValidOffsets(forward_offsets, document_count, forward_entries.size())) {
+            return false;
+        }
+        for (const TermId term : sorted_terms) {
+            if (term >= term_count) {
+                return false;
+            }
+        }
+        for (const auto [document_id, ordinal] : document_ids) {
+            if (ordinal >= document_count) {
+                return false;
+            }
+        }
+        for (const PostingListRecord& record : posting_lists) {
+            // The block count is bounded by the first check, so the products can not overflow
+            if (!FitsIn(record.blocks_offset, record.block_count, posting_blocks.size())
+                || !FitsIn(record.postings_offset, record.posting_count, postings.size())
+                || !FitsIn(record.block_term_freqs_offset, record.block_count * BLOCK_SIZE, block_term_freqs.size())
+                || !FitsIn(record.block_max_term_freqs_offset,
+                           record.block_count + (record.posting_count + BLOCK_SIZE - 1) / BLOCK_SIZE,
+                           block_max_term_freqs.size())
+                || record.packed_deltas_offset > packed_deltas.size()) {
+                return false;
+            }
+            const size_t packed_delta_count = packed_deltas.size() - record.packed_deltas_offset;
+            for (uint64_t i = 0; i < record.block_count; ++i) {
+                const PostingListView::Block& block = posting_blocks[record.blocks_offset + i];
+                if (block.bit_width > 32
+                    || !FitsIn(block.packed_offset, GetPackedWordCount(block.bit_width), packed_delta_count)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    std::string_view GetWord(TermId term) const {
+        return GetString(term_text, term_offsets, term);
+    }
+};
 
 SearchServer::SearchServer(std::string_view stop_words_text)
         : SearchServer(SplitIntoWords(stop_words_text)) {}
@@ -9,79 +203,386 @@ SearchServer::SearchServer(std::string_view stop_words_text)
 SearchServer::SearchServer(const std::string& stop_words_text)
         : SearchServer(std::string_view(stop_words_text)) {}
 
+SearchServer::SearchServer(const SearchServer& other)
+        : stop_words_(other.stop_words_)
+        , terms_(other.terms_)
+        , word_to_document_freqs_(other.word_to_document_freqs_)
+        , posting_format_(other.posting_format_)
+        , log_document_count_(other.log_document_count_)
+        , forward_index_(other.forward_index_)
+        , documents_(other.documents_)
+        , document_ordinals_(other.document_ordinals_)
+        , document_ids_(other.document_ids_)
+        , index_epoch_(other.index_epoch_)
+        , mapped_index_(other.mapped_index_) {
+    // The texts are stored again, the views of the original point into its arena
+    document_texts_.reserve(other.document_texts_.size());
+    for (const std::string_view text : other.document_texts_) {
+        document_texts_.push_back(text.empty() ? std::string_view() : document_text_arena_.Store(text));
+    }
+    if (other.result_cache_) {
+        result_cache_ = std::make_unique<QueryResultCache>(other.result_cache_->GetCapacity());
+    }
+}
+
 void SearchServer::AddDocument(int document_id, const std::string_view document, DocumentStatus status,
                                const std::vector<int>& ratings) {
-    if ((document_id < 0) || (documents_.count(document_id) > 0)) {
+    CheckNotMapped();
+    if ((document_id < 0) || (document_ordinals_.count(document_id) > 0)) {
         throw std::invalid_argument("Invalid document_id");
     }
-    const auto [it, inserted] = documents_.emplace(document_id, DocumentData{ ComputeAverageRating(ratings), status, std::string(document) });
-    const auto words = SplitIntoWordsNoStop(it->second.text);
-    const double inv_word_count = 1.0 / words.size();
-    for (const std::string_view word : words) {
-        word_to_document_freqs_[word][document_id] += inv_word_count;
-        document_id_to_words_freq_[document_id][word] += inv_word_count;
+    const auto word_freqs = ComputeWordFrequencies(document);
+    const auto ordinal = static_cast<DocumentOrdinal>(documents_.size());
+    documents_.push_back(DocumentData{ document_id, ComputeAverageRating(ratings), status });
+    document_texts_.push_back(document_text_arena_.Store(document));
+    document_ordinals_.emplace(document_id, ordinal);
+    log_document_count_ = std::log(GetDocumentCount());
+    ++index_epoch_;
+    std::vector<TermFrequency> term_freqs;
+    term_freqs.reserve(word_freqs.size());
+    for (const auto& [word, term_freq] : word_freqs) {
+        term_freqs.push_back({terms_.Intern(word), term_freq});
+    }
+    SortByTerm(term_freqs);
+    forward_index_.Add(term_freqs);
+    word_to_document_freqs_.resize(terms_.size(), PostingList(posting_format_));
+    for (const auto [word, term_freq] : term_freqs) {
+        word_to_document_freqs_[word].Add(ordinal, term_freq);
     }
     document_ids_.emplace(document_id);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status) const {
+std::pair<size_t, std::exception_ptr> SearchServer::FindFirstInvalidDocument(
+        const std::vector<NewDocument>& documents) const {
+    std::set<int> batch_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const int document_id = documents[i].id;
+        try {
+            CheckNotMapped();
+            if (document_id < 0 || document_ordinals_.count(document_id) > 0 || !batch_ids.insert(document_id).second) {
+                throw std::invalid_argument("Invalid document_id");
+            }
+            SplitIntoWordsNoStop(documents[i].text, word_buffer);
+        } catch (...) {
+            return {i, std::current_exception()};
+        }
+    }
+    return {documents.size(), nullptr};
+}
+
+void SearchServer::AddDocuments(const std::vector<NewDocument>& documents) {
+    AddDocumentBatch(std::execution::seq, documents);
+}
 
-    return FindTopDocuments(
-            std::execution::seq,
-            raw_query,
-            [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-            });
+void SearchServer::AddDocuments(std::execution::sequenced_policy policy, const std::vector<NewDocument>& documents) {
+    AddDocumentBatch(policy, documents);
 }
+
+void SearchServer::AddDocuments(std::execution::parallel_policy policy, const std::vector<NewDocument>& documents) {
+    AddDocumentBatch(policy, documents);
+}
+
 template <class ExecutionPolicy>
-std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status) const {
+void SearchServer::AddDocumentBatch(ExecutionPolicy&& policy, const std::vector<NewDocument>& documents) {
+    CheckNotMapped();
+    // Documents after the first one with an invalid id are not tokenized
+    size_t invalid_id_index = documents.size();
+    std::set<int> batch_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const int document_id = documents[i].id;
+        if (document_id < 0 || document_ordinals_.count(document_id) > 0 || !batch_ids.insert(document_id).second) {
+            invalid_id_index = i;
+            break;
+        }
+    }
+
+    // Exceptions can not leave a parallel algorithm, so they are kept per document
+    std::vector<std::vector<std::pair<std::string_view, double>>> word_freqs(invalid_id_index);
+    std::vector<std::exception_ptr> errors(invalid_id_index);
+    std::vector<size_t> indexes(invalid_id_index);
+    std::iota(indexes.begin(), indexes.end(), 0);
+    std::for_each(policy, indexes.begin(), indexes.end(),
+                  [this, &documents, &word_freqs, &errors](size_t i) {
+                      try {
+                          word_freqs[i] = ComputeWordFrequencies(documents[i].text);
+                      } catch (...) {
+                          errors[i] = std::current_exception();
+                      }
+                  });
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    if (invalid_id_index < documents.size()) {
+        throw std::invalid_argument("Invalid document_id");
+    }
+
+    // Postings of the batch are grouped by word with a counting sort. New ordinals
+    // exceed the existing ones, so every group is a plain append to its list
+    const auto first_ordinal = static_cast<DocumentOrdinal>(documents_.size());
+    std::vector<std::vector<TermId>> document_terms(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        document_terms[i].reserve(word_freqs[i].size());
+        for (const auto& [word, term_freq] : word_freqs[i]) {
+            document_terms[i].push_back(terms_.Intern(word));
+        }
+    }
+    std::vector<size_t> group_offsets(terms_.size() + 1, 0);
+    for (const auto& terms : document_terms) {
+        for (const TermId term : terms) {
+            ++group_offsets[term + 1];
+        }
+    }
+    std::partial_sum(group_offsets.begin(), group_offsets.end(), group_offsets.begin());
+    std::vector<PostingList::Posting> grouped_postings(group_offsets.back());
+    std::vector<size_t> group_ends(group_offsets.begin(), group_offsets.end() - 1);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        for (size_t j = 0; j < document_terms[i].size(); ++j) {
+            grouped_postings[group_ends[document_terms[i][j]]++] =
+                    {static_cast<DocumentOrdinal>(first_ordinal + i), word_freqs[i][j].second};
+        }
+    }
 
-    return FindTopDocuments(
-            policy,
-            raw_query,
-            [status](int document_id, DocumentStatus document_status, int rating) {
-                return document_status == status;
-            });
+    word_to_document_freqs_.resize(terms_.size(), PostingList(posting_format_));
+    std::vector<TermId> batch_terms;
+    for (TermId term = 0; term < terms_.size(); ++term) {
+        if (group_offsets[term] != group_offsets[term + 1]) {
+            batch_terms.push_back(term);
+        }
+    }
+    std::for_each(policy, batch_terms.begin(), batch_terms.end(),
+                  [this, &group_offsets, &grouped_postings](TermId term) {
+                      PostingList& postings = word_to_document_freqs_[term];
+                      for (size_t i = group_offsets[term]; i < group_offsets[term + 1]; ++i) {
+                          postings.Add(grouped_postings[i].ordinal, grouped_postings[i].term_freq);
+                      }
+                  });
+
+    std::vector<std::vector<TermFrequency>> document_term_freqs(documents.size());
+    std::for_each(policy, indexes.begin(), indexes.end(),
+                  [&document_term_freqs, &document_terms, &word_freqs](size_t i) {
+                      document_term_freqs[i].reserve(document_terms[i].size());
+                      for (size_t j = 0; j < document_terms[i].size(); ++j) {
+                          document_term_freqs[i].push_back({document_terms[i][j], word_freqs[i][j].second});
+                      }
+                      SortByTerm(document_term_freqs[i]);
+                  });
+    documents_.reserve(documents_.size() + documents.size());
+    document_texts_.reserve(document_texts_.size() + documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const NewDocument& document = documents[i];
+        documents_.push_back(DocumentData{ document.id, ComputeAverageRating(document.ratings), document.status });
+        document_texts_.push_back(document_text_arena_.Store(document.text));
+        document_ordinals_.emplace(document.id, static_cast<DocumentOrdinal>(first_ordinal + i));
+        forward_index_.Add(document_term_freqs[i]);
+        document_ids_.emplace(document.id);
+    }
+    log_document_count_ = std::log(GetDocumentCount());
+    ++index_epoch_;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status, size_t top_k) const {
+
+    return FindTopDocuments(std::execution::seq, raw_query, status, top_k);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query) const{
-    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, size_t top_k) const{
+    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL, top_k);
 }
 
 
-std::vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy, std::string_view raw_query) const{
-    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL);
+std::vector<Document> SearchServer::FindTopDocuments(std::execution::sequenced_policy, std::string_view raw_query, size_t top_k) const{
+    return FindTopDocuments(std::execution::seq, raw_query, DocumentStatus::ACTUAL, top_k);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy, std::string_view raw_query, size_t top_k) const{
+    return FindTopDocuments(std::execution::par, raw_query, DocumentStatus::ACTUAL, top_k);
 }
 
-std::vector<Document> SearchServer::FindTopDocuments(std::execution::parallel_policy, std::string_view raw_query) const{
-    return FindTopDocuments(std::execution::par, raw_query, DocumentStatus::ACTUAL);
+SearchServer::QueryStatistics SearchServer::GetQueryStatistics(std::string_view raw_query) const {
+    QueryStatistics statistics;
+    statistics.document_count = GetDocumentCount();
+    // Words unknown to this server are kept with zero frequency, other parts may know them
+    const bool is_valid_query = SplitIntoWords(raw_query, word_buffer);
+    for (const std::string_view word : word_buffer) {
+        const auto query_word = ParseQueryWord(word, is_valid_query);
+        if (query_word.is_stop || query_word.is_minus) {
+            continue;
+        }
+        const TermId term = FindTerm(query_word.data);
+        statistics.document_freqs.emplace(query_word.data, term == TermDictionary::NO_TERM
+                                                           ? 0
+                                                           : GetPostings(term).GetDocumentFreq());
+    }
+    return statistics;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, const QueryStatistics& statistics,
+                                                     DocumentStatus status, size_t top_k) const {
+    Query query = ParseQuery(raw_query, true);
+    // Computed like ComputeWordInverseDocumentFreq, so a single server gives the same values
+    const double log_document_count = std::log(statistics.document_count);
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        const auto it = statistics.document_freqs.find(GetWord(query.plus_words[i]));
+        if (it != statistics.document_freqs.end() && it->second > 0) {
+            query.inverse_document_freqs[i] = log_document_count - std::log(it->second);
+        }
+    }
+    return FindTopDocuments(std::execution::seq, query,
+                            [status](int, DocumentStatus document_status, int) {
+                                return document_status == status;
+                            },
+                            top_k);
+}
+
+SearchServer::PreparedQuery SearchServer::PrepareQuery(std::string_view raw_query) const {
+    PreparedQuery prepared;
+    prepared.query_ = ParseQuery(raw_query, true);
+    prepared.text_ = raw_query;
+    prepared.server_id_ = server_id_;
+    prepared.index_epoch_ = index_epoch_;
+    prepared.term_count_ = terms_.size();
+    return prepared;
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentStatus status,
+                                                     size_t top_k) const {
+    return FindTopDocuments(std::execution::seq, query, status, top_k);
+}
+
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, size_t top_k) const {
+    return FindTopDocuments(std::execution::seq, query, DocumentStatus::ACTUAL, top_k);
+}
+
+const SearchServer::Query& SearchServer::ResolvePreparedQuery(const PreparedQuery& prepared, Query& buffer) const {
+    // Term ids are never reassigned, only new words get new ones. A server
+    // opened from a snapshot has an empty and fixed terms_
+    if (prepared.server_id_ != server_id_
+        || (prepared.query_.has_unknown_words && prepared.term_count_ != terms_.size())) {
+        buffer = ParseQuery(prepared.text_, true);
+        return buffer;
+    }
+    if (prepared.index_epoch_ == index_epoch_) {
+        return prepared.query_;
+    }
+    buffer = prepared.query_;
+    for (size_t i = 0; i < buffer.plus_words.size(); ++i) {
+        buffer.inverse_document_freqs[i] = ComputeWordInverseDocumentFreq(GetPostings(buffer.plus_words[i]));
+    }
+    return buffer;
+}
+
+SearchServer::BatchResults SearchServer::FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                                               DocumentStatus status, size_t top_k) const {
+    std::vector<Query> queries(raw_queries.size());
+    std::vector<std::exception_ptr> errors(raw_queries.size());
+    std::vector<size_t> query_indexes(raw_queries.size());
+    std::iota(query_indexes.begin(), query_indexes.end(), 0);
+    std::for_each(std::execution::par, query_indexes.begin(), query_indexes.end(), [&](size_t i) {
+        try {
+            queries[i] = ParseQuery(raw_queries[i], true);
+        } catch (...) {
+            errors[i] = std::current_exception();
+        }
+    });
+    // The first invalid query is reported, as if the queries were answered one by one
+    for (const std::exception_ptr& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // Parsed queries have sorted unique words, so reordered or repeated words still match
+    const auto query_key = [&queries](size_t i) {
+        return std::tie(queries[i].plus_words, queries[i].minus_words);
+    };
+    std::sort(std::execution::par, query_indexes.begin(), query_indexes.end(), [&query_key](size_t lhs, size_t rhs) {
+        return query_key(lhs) < query_key(rhs);
+    });
+    BatchResults batch;
+    batch.result_indexes.resize(raw_queries.size());
+    // A representative query of every result
+    std::vector<size_t> result_queries;
+    for (size_t i = 0; i < query_indexes.size(); ++i) {
+        if (i == 0 || query_key(query_indexes[i - 1]) != query_key(query_indexes[i])) {
+            result_queries.push_back(query_indexes[i]);
+        }
+        batch.result_indexes[query_indexes[i]] = result_queries.size() - 1;
+    }
+
+    // Reading the longest posting list dominates the cost of a query. Queries sharing it
+    // are neighbours in the schedule, so the parallel loop hands them to the same worker
+    // while the list is still in cache
+    std::vector<std::pair<TermId, size_t>> schedule(result_queries.size());
+    for (size_t result = 0; result < result_queries.size(); ++result) {
+        TermId longest_term = TermDictionary::NO_TERM;
+        size_t longest_size = 0;
+        for (const TermId term : queries[result_queries[result]].plus_words) {
+            const size_t size = GetPostings(term).GetDocumentFreq();
+            if (longest_term == TermDictionary::NO_TERM || size > longest_size) {
+                longest_term = term;
+                longest_size = size;
+            }
+        }
+        schedule[result] = {longest_term, result};
+    }
+    std::sort(schedule.begin(), schedule.end());
+
+    const auto document_predicate = [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    };
+    batch.results.resize(result_queries.size());
+    std::for_each(std::execution::par, schedule.begin(), schedule.end(), [&](const std::pair<TermId, size_t>& task) {
+        const size_t result = task.second;
+        const Query& query = queries[result_queries[result]];
+        if (!result_cache_) {
+            batch.results[result] = FindTopDocuments(std::execution::seq, query, document_predicate, top_k);
+            return;
+        }
+        const QueryCacheKey key{{query.plus_words.begin(), query.plus_words.end()},
+                                {query.minus_words.begin(), query.minus_words.end()},
+                                static_cast<uint32_t>(status), top_k};
+        if (auto documents = result_cache_->Find(key, index_epoch_)) {
+            batch.results[result] = std::move(*documents);
+        } else {
+            batch.results[result] = FindTopDocuments(std::execution::seq, query, document_predicate, top_k);
+            result_cache_->Insert(key, index_epoch_, batch.results[result]);
+        }
+    });
+    return batch;
 }
 
 using GigaChadMatchDoc = std::tuple<std::vector<std::string_view>, DocumentStatus>;
 GigaChadMatchDoc SearchServer::MatchDocument(const std::string_view raw_query, int document_id) const {
-    const auto query = ParseQuery(raw_query, true);
+    return MatchDocument(ParseQuery(raw_query, true), document_id);
+}
 
-    for (const std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            return{{}, documents_.at(document_id).status};
+GigaChadMatchDoc SearchServer::MatchDocument(const PreparedQuery& query, int document_id) const {
+    Query buffer;
+    return MatchDocument(ResolvePreparedQuery(query, buffer), document_id);
+}
+
+GigaChadMatchDoc SearchServer::MatchDocument(const Query& query, int document_id) const {
+    const DocumentOrdinal ordinal = document_ordinals_.at(document_id);
+
+    const DocumentStatus status = GetDocuments()[ordinal].status;
+    for (const TermId word : query.minus_words) {
+        if (GetPostings(word).Contains(ordinal)) {
+            return {std::vector<std::string_view>{}, status};
         }
     }
 
     std::vector<std::string_view> matched_words;
-    for (const std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        if (word_to_document_freqs_.at(word).count(document_id)) {
-            matched_words.push_back(word);
+    for (const TermId word : query.plus_words) {
+        if (GetPostings(word).Contains(ordinal)) {
+            matched_words.push_back(GetWord(word));
         }
     }
+    sort(matched_words.begin(), matched_words.end());
 
     //return { matched_words, documents_.at(document_id).status };
-    return { std::vector<std::string_view>(matched_words.begin(), matched_words.end()), documents_.at(document_id).status };
+    return { std::vector<std::string_view>(matched_words.begin(), matched_words.end()), status };
 }
 
 GigaChadMatchDoc SearchServer::MatchDocument(std::execution::sequenced_policy policy, const std::string_view raw_query, int document_id) const{
@@ -90,28 +591,35 @@ GigaChadMatchDoc SearchServer::MatchDocument(std::execution::sequenced_policy po
 
 GigaChadMatchDoc SearchServer::MatchDocument(std::execution::parallel_policy policy, const std::string_view raw_query, int document_id) const{
     const auto query = ParseQuery(raw_query, false);
+    const DocumentOrdinal ordinal = document_ordinals_.at(document_id);
 
+    const DocumentStatus status = GetDocuments()[ordinal].status;
     const auto word_checker =
-            [this, document_id](const std::string_view word){
-                const auto it = word_to_document_freqs_.find(word);
-                return it != word_to_document_freqs_.end() && it->second.count(document_id);
+            [this, ordinal](const TermId word){
+                return GetPostings(word).Contains(ordinal);
             };
-    if (any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker)){
-        return{{}, documents_.at(document_id).status};
+    if (std::any_of(std::execution::par, query.minus_words.begin(), query.minus_words.end(), word_checker)){
+        return {std::vector<std::string_view>{}, status};
     }
 
-    std::vector<std::string_view> matched_words(query.plus_words.size());
-    auto words_end = copy_if(
+    std::vector<TermId> matched_terms(query.plus_words.size());
+    auto terms_end = copy_if(
             std::execution::par,
             query.plus_words.begin(), query.plus_words.end(),
-            matched_words.begin(),
+            matched_terms.begin(),
             word_checker);
-    sort(matched_words.begin(), words_end);
-    words_end = unique(matched_words.begin(), words_end);
-    matched_words.erase(words_end, matched_words.end());
+    sort(matched_terms.begin(), terms_end);
+    terms_end = unique(matched_terms.begin(), terms_end);
+
+    std::vector<std::string_view> matched_words(terms_end - matched_terms.begin());
+    std::transform(matched_terms.begin(), terms_end, matched_words.begin(),
+                   [this](const TermId word) {
+                       return GetWord(word);
+                   });
+    sort(matched_words.begin(), matched_words.end());
 
 
-    return { matched_words, documents_.at(document_id).status };
+    return { matched_words, status };
 }
 
 bool SearchServer::IsValidWord(const std::string_view word) {
@@ -121,6 +629,20 @@ bool SearchServer::IsValidWord(const std::string_view word) {
     });
 }
 
+uint64_t SearchServer::NextServerId() {
+    static std::atomic<uint64_t> last_server_id = 0;
+    return ++last_server_id;
+}
+
+bool SearchServer::IsMoreRelevant(const Document& lhs, const Document& rhs) {
+    if (std::abs(lhs.relevance - rhs.relevance) < PRECISION){
+        return lhs.rating > rhs.rating;
+    }
+    else {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
 int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
@@ -129,25 +651,43 @@ int SearchServer::ComputeAverageRating(const std::vector<int>& ratings) {
     return rating_sum / static_cast<int>(ratings.size());
 }
 
-std::vector<std::string_view> SearchServer::SplitIntoWordsNoStop(std::string_view text) const{
+void SearchServer::SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const{
     using namespace std::string_literals;
 
-    std::vector<std::string_view> words;
-    for (std::string_view word : SplitIntoWords(text))
+    if (!SplitIntoWords(text, words))
     {
-        if (!IsValidWord(word))
+        // Only the search for the word to report scans the words one by one
+        for (std::string_view word : words)
         {
-            throw std::invalid_argument("Word "s + word.data() + " is invalid"s);
+            if (!IsValidWord(word))
+            {
+                throw std::invalid_argument("Word "s + word.data() + " is invalid"s);
+            }
         }
-        if (!IsStopWord(word))
-        {
-            words.push_back(word);
+    }
+    words.erase(std::remove_if(words.begin(), words.end(),
+                               [this](std::string_view word) {
+                                   return IsStopWord(word);
+                               }),
+                words.end());
+}
+
+std::vector<std::pair<std::string_view, double>> SearchServer::ComputeWordFrequencies(std::string_view text) const {
+    auto& words = word_buffer;
+    SplitIntoWordsNoStop(text, words);
+    std::sort(words.begin(), words.end());
+    const double inv_word_count = 1.0 / words.size();
+    std::vector<std::pair<std::string_view, double>> word_freqs;
+    for (const std::string_view word : words) {
+        if (word_freqs.empty() || word_freqs.back().first != word) {
+            word_freqs.emplace_back(word, 0.0);
         }
+        word_freqs.back().second += inv_word_count;
     }
-    return words;
+    return word_freqs;
 }
 
-SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text) const {
+SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text, bool is_valid_text) const {
     if (text.empty()) {
         throw std::invalid_argument("Query word is empty");
     }
@@ -157,65 +697,66 @@ SearchServer::QueryWord SearchServer::ParseQueryWord(const std::string_view text
         is_minus = true;
         word = word.substr(1);
     }
-    if (word.empty() || word[0] == '-' || !IsValidWord(word)) {
+    if (word.empty() || word[0] == '-' || (!is_valid_text && !IsValidWord(word))) {
         throw std::invalid_argument("Query word // is invalid"); // /*" + text + "*/
     }
     return {word, is_minus, IsStopWord(word)};
 }
 
 SearchServer::Query SearchServer::ParseQuery(const std::string_view text, bool need_sort) const{
+    INSTRUMENT_STAGE(QueryStage::PARSE);
     Query query;
-    auto  vector_words = SplitIntoWords(text);
+    const bool is_valid_text = SplitIntoWords(text, word_buffer);
 
-    for (const std::string_view word : vector_words) {
-        const auto query_word = ParseQueryWord(word);
-        if (!query_word.is_stop) {
-            if (query_word.is_minus) {
-                query.minus_words.push_back(query_word.data);
-            }
-            else {
-                query.plus_words.push_back(query_word.data);
-            }
+    for (const std::string_view word : word_buffer) {
+        const auto query_word = ParseQueryWord(word, is_valid_text);
+        if (query_word.is_stop) {
+            continue;
+        }
+        const TermId term = FindTerm(query_word.data);
+        if (term == TermDictionary::NO_TERM) {
+            query.has_unknown_words = true;
+            continue;
+        }
+        if (query_word.is_minus) {
+            query.minus_words.push_back(term);
+        }
+        else {
+            query.plus_words.push_back(term);
         }
     }
 
     if (need_sort){
             for (auto* words : {&query.plus_words, &query.minus_words}){
-            sort(words->begin(), words->end());
-            words->erase(unique(words->begin(),words->end()), words->end());
+            std::sort(words->begin(), words->end());
+            words->erase(std::unique(words->begin(),words->end()), words->end());
         }
     }
+    query.inverse_document_freqs.reserve(query.plus_words.size());
+    for (const TermId term : query.plus_words) {
+        query.inverse_document_freqs.push_back(ComputeWordInverseDocumentFreq(GetPostings(term)));
+    }
     return query;
 }
 
-const std::map<std::string_view, double>& SearchServer::GetWordFrequencies(int document_id) const {
-    auto it = document_id_to_words_freq_.find(document_id);
-
-    std::map<std::string_view, double>* result = new std::map<std::string_view, double>;
-
-    if (it != document_id_to_words_freq_.end()) {
-        result->insert(it->second.begin(), it->second.end());
+SearchServer::WordFrequencies SearchServer::GetWordFrequencies(int document_id) const {
+    const auto it = document_ordinals_.find(document_id);
+    if (it == document_ordinals_.end()) {
+        return WordFrequencies(this, {});
     }
-    return *result;
-}
-
-// Existence required
-double SearchServer::ComputeWordInverseDocumentFreq(const std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+    return WordFrequencies(this, GetTermFrequencies(it->second));
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    if (document_id_to_words_freq_.count(document_id)){
+    CheckNotMapped();
+    if (document_ordinals_.count(document_id)){
 
-        for (auto& [_, documentIdToTF] : word_to_document_freqs_) {
-            if (documentIdToTF.count(document_id)) {
-                documentIdToTF.erase(document_id);
-            }
+        const DocumentOrdinal ordinal = document_ordinals_.at(document_id);
+        for (const auto [word, _] : forward_index_.Get(ordinal)) {
+            word_to_document_freqs_[word].MarkRemoved();
         }
-        document_id_to_words_freq_.erase(document_id);
-        documents_.erase(document_id);
-        auto iter = find(document_ids_.begin(), document_ids_.end(), document_id);
-        document_ids_.erase(iter);
+        ReleaseDocumentData(ordinal);
+        document_ids_.erase(document_id);
     }}
 
 void SearchServer::RemoveDocument(std::execution::sequenced_policy policy, int document_id) {
@@ -223,24 +764,273 @@ void SearchServer::RemoveDocument(std::execution::sequenced_policy policy, int d
 }
 
 void SearchServer::RemoveDocument(std::execution::parallel_policy policy, int document_id) {
-    if (documents_.count(document_id) == 0){
+    CheckNotMapped();
+    if (document_ordinals_.count(document_id) == 0){
         return;
     }
+    const DocumentOrdinal ordinal = document_ordinals_.at(document_id);
 
-    documents_.erase(document_id);
+    const TermFrequencyRange term_freqs = forward_index_.Get(ordinal);
+    std::for_each(std::execution::par, term_freqs.begin(), term_freqs.end(),
+                  [this](const TermFrequency& term_freq) {
+                      word_to_document_freqs_[term_freq.term].MarkRemoved();
+                  });
 
-    auto word_freq = std::move(document_id_to_words_freq_.at(document_id));
-    std::vector<std::string_view> words(word_freq.size());
-    std::transform(std::execution::par,
-                   word_freq.begin(), word_freq.end(), words.begin(),
-                   [](const auto w_f) {
-                       return w_f.first;
-                   });
+    ReleaseDocumentData(ordinal);
+    document_ids_.erase(document_id);
+}
 
-    std::for_each(std::execution::par, words.begin(), words.end(),
-                  [&document_id, this](const auto word) {
-                      word_to_document_freqs_.at(word).erase(document_id);
+void SearchServer::Compact() {
+    CheckNotMapped();
+    if (documents_.size() == document_ordinals_.size()) {
+        return;
+    }
+    const auto new_ordinals = ComputeCompactedOrdinals();
+    // Posting lists are independent, so they are rebuilt in parallel
+    std::for_each(std::execution::par,
+                  word_to_document_freqs_.begin(), word_to_document_freqs_.end(),
+                  [&new_ordinals](PostingList& postings) {
+                      postings.Compact(new_ordinals);
                   });
+    // Live texts move to a new arena, the chunks of the old one are freed with it
+    TextArena text_arena;
+    for (DocumentOrdinal ordinal = 0; ordinal < documents_.size(); ++ordinal) {
+        if (new_ordinals[ordinal] != REMOVED_ORDINAL) {
+            documents_[new_ordinals[ordinal]] = documents_[ordinal];
+            document_texts_[new_ordinals[ordinal]] = text_arena.Store(document_texts_[ordinal]);
+        }
+    }
+    document_text_arena_ = std::move(text_arena);
+    forward_index_.Compact(new_ordinals);
+    documents_.resize(document_ordinals_.size());
+    documents_.shrink_to_fit();
+    document_texts_.resize(document_ordinals_.size());
+    document_texts_.shrink_to_fit();
+    for (auto& [document_id, ordinal] : document_ordinals_) {
+        ordinal = new_ordinals[ordinal];
+    }
+}
+
+
+void SearchServer::SaveSnapshot(const std::string& path) const {
+    CheckNotMapped();
+    SnapshotWriter writer(path, SNAPSHOT_VERSION);
+    WriteStrings(writer, STOP_WORD_TEXT, STOP_WORD_OFFSETS, stop_words_.GetWords());
+
+    std::vector<std::string_view> words(terms_.size());
+    std::vector<TermId> sorted_terms(terms_.size());
+    for (TermId term = 0; term < terms_.size(); ++term) {
+        words[term] = terms_.GetWord(term);
+        sorted_terms[term] = term;
+    }
+    std::sort(sorted_terms.begin(), sorted_terms.end(), [&words](TermId lhs, TermId rhs) {
+        return words[lhs] < words[rhs];
+    });
+    WriteStrings(writer, TERM_TEXT, TERM_OFFSETS, words);
+    writer.WriteSection(SORTED_TERMS, sorted_terms);
+
+    // Removed documents are left out, the snapshot gets the ordinals a compaction would assign
+    const auto new_ordinals = ComputeCompactedOrdinals();
+    const bool has_removed = documents_.size() != document_ordinals_.size();
+    std::vector<PostingListRecord> posting_lists;
+    std::vector<PostingListView::Posting> postings;
+    std::vector<PostingListView::Block> posting_blocks;
+    std::vector<uint32_t> packed_deltas;
+    std::vector<float> block_term_freqs;
+    std::vector<double> block_max_term_freqs;
+    for (const PostingList& source : word_to_document_freqs_) {
+        PostingList compacted;
+        if (has_removed) {
+            compacted = source;
+            compacted.Compact(new_ordinals);
+        }
+        const PostingListView view = has_removed ? compacted.View() : source.View();
+        const PostingListView::Parts& parts = view.GetParts();
+        posting_lists.push_back({postings.size(), parts.posting_count, posting_blocks.size(), parts.block_count,
+                                 packed_deltas.size(), block_term_freqs.size(), block_max_term_freqs.size(),
+                                 parts.max_term_freq, parts.document_freq, parts.log_document_freq});
+        Append(postings, parts.postings, parts.posting_count);
+        Append(posting_blocks, parts.blocks, parts.block_count);
+        if (parts.block_count > 0) {
+            const PostingListView::Block& last_block = parts.blocks[parts.block_count - 1];
+            Append(packed_deltas, parts.packed_deltas, last_block.packed_offset + GetPackedWordCount(last_block.bit_width));
+        }
+        Append(block_term_freqs, parts.block_term_freqs, parts.block_count * BLOCK_SIZE);
+        Append(block_max_term_freqs, parts.block_max_term_freqs, view.GetBlockCount());
+    }
+    writer.WriteSection(POSTING_LISTS, posting_lists);
+    writer.WriteSection(POSTINGS, postings);
+    writer.WriteSection(POSTING_BLOCKS, posting_blocks);
+    writer.WriteSection(PACKED_DELTAS, packed_deltas);
+    writer.WriteSection(BLOCK_TERM_FREQS, block_term_freqs);
+    writer.WriteSection(BLOCK_MAX_TERM_FREQS, block_max_term_freqs);
+
+    std::vector<DocumentData> documents;
+    std::vector<std::string_view> texts;
+    for (DocumentOrdinal ordinal = 0; ordinal < documents_.size(); ++ordinal) {
+        if (!documents_[ordinal].is_removed) {
+            documents.push_back(documents_[ordinal]);
+            texts.push_back(document_texts_[ordinal]);
+        }
+    }
+    // The snapshot keeps the layout of the forward index, so it is written as is
+    ForwardIndex compacted_forward_index;
+    if (has_removed) {
+        compacted_forward_index = forward_index_;
+        compacted_forward_index.Compact(new_ordinals);
+    }
+    const ForwardIndex& forward_index = has_removed ? compacted_forward_index : forward_index_;
+    std::vector<DocumentIdOrdinal> document_ids;
+    for (const auto [document_id, ordinal] : document_ordinals_) {
+        document_ids.push_back({document_id, new_ordinals[ordinal]});
+    }
+    writer.WriteSection(DOCUMENTS, documents);
+    writer.WriteSection(DOCUMENT_IDS, document_ids);
+    WriteStrings(writer, DOCUMENT_TEXT, DOCUMENT_TEXT_OFFSETS, texts);
+    writer.WriteSection(FORWARD_OFFSETS, forward_index.GetOffsets());
+    writer.WriteSection(FORWARD_ENTRIES, forward_index.GetEntries());
+    writer.Finish();
+}
+
+SearchServer SearchServer::OpenSnapshot(const std::string& path) {
+    return SearchServer(std::make_shared<const MappedIndex>(path));
+}
+
+SearchServer::SearchServer(std::shared_ptr<const MappedIndex> mapped_index)
+        : stop_words_(MakeUniqueNonEmptyStrings(mapped_index->stop_words))
+        , mapped_index_(std::move(mapped_index)) {
+    for (const auto [document_id, ordinal] : mapped_index_->document_ids) {
+        document_ordinals_.emplace_hint(document_ordinals_.end(), document_id, ordinal);
+        document_ids_.emplace_hint(document_ids_.end(), document_id);
+    }
+    log_document_count_ = std::log(GetDocumentCount());
+}
+
+void SearchServer::SetResultCacheCapacity(size_t capacity) {
+    if (capacity == 0) {
+        result_cache_.reset();
+    } else {
+        result_cache_ = std::make_unique<QueryResultCache>(capacity);
+    }
+}
+
+const QueryResultCache* SearchServer::GetResultCache() const noexcept {
+    return result_cache_.get();
+}
 
-    document_id_to_words_freq_.erase(document_id);
+void SearchServer::SetPostingFormat(PostingList::Format format) {
+    CheckNotMapped();
+    posting_format_ = format;
+    for (PostingList& postings : word_to_document_freqs_) {
+        postings.SetFormat(format);
+    }
+    // Rounded term frequencies change the relevance
+    ++index_epoch_;
+}
+
+void SearchServer::ReleaseDocumentData(DocumentOrdinal ordinal) {
+    DocumentData& document_data = documents_[ordinal];
+    document_ordinals_.erase(document_data.id);
+    log_document_count_ = std::log(GetDocumentCount());
+    ++index_epoch_;
+    document_data.is_removed = true;
+    // The arena space is reclaimed by Compact
+    document_texts_[ordinal] = {};
+}
+
+void SearchServer::CheckNotMapped() const {
+    if (mapped_index_) {
+        throw std::logic_error("Search server opened from a snapshot is read-only");
+    }
+}
+
+TermId SearchServer::FindTerm(std::string_view word) const {
+    if (!mapped_index_) {
+        return terms_.Find(word);
+    }
+    const auto& sorted_terms = mapped_index_->sorted_terms;
+    const auto it = std::lower_bound(sorted_terms.begin(), sorted_terms.end(), word,
+                                     [this](TermId term, std::string_view word) {
+                                         return mapped_index_->GetWord(term) < word;
+                                     });
+    return it != sorted_terms.end() && mapped_index_->GetWord(*it) == word ? *it : TermDictionary::NO_TERM;
+}
+
+std::string_view SearchServer::GetWord(TermId term) const {
+    return mapped_index_ ? mapped_index_->GetWord(term) : terms_.GetWord(term);
+}
+
+PostingListView SearchServer::GetPostings(TermId term) const {
+    if (!mapped_index_) {
+        return word_to_document_freqs_[term].View();
+    }
+    const MappedIndex& index = *mapped_index_;
+    const PostingListRecord& record = index.posting_lists[term];
+    PostingListView::Parts parts;
+    parts.postings = index.postings.data() + record.postings_offset;
+    parts.posting_count = record.posting_count;
+    parts.blocks = index.posting_blocks.data() + record.blocks_offset;
+    parts.block_count = record.block_count;
+    parts.packed_deltas = index.packed_deltas.data() + record.packed_deltas_offset;
+    parts.block_term_freqs = index.block_term_freqs.data() + record.block_term_freqs_offset;
+    parts.block_max_term_freqs = index.block_max_term_freqs.data() + record.block_max_term_freqs_offset;
+    parts.max_term_freq = record.max_term_freq;
+    parts.document_freq = record.document_freq;
+    parts.log_document_freq = record.log_document_freq;
+    return PostingListView(parts);
+}
+
+const SearchServer::DocumentData* SearchServer::GetDocuments() const noexcept {
+    return mapped_index_ ? mapped_index_->documents.data() : documents_.data();
+}
+
+size_t SearchServer::GetDocumentSlotCount() const noexcept {
+    return mapped_index_ ? mapped_index_->documents.size() : documents_.size();
+}
+
+TermFrequencyRange SearchServer::GetTermFrequencies(DocumentOrdinal ordinal) const noexcept {
+    if (!mapped_index_) {
+        return forward_index_.Get(ordinal);
+    }
+    const auto& forward_offsets = mapped_index_->forward_offsets;
+    const TermFrequency* entries = mapped_index_->forward_entries.data();
+    return {entries + forward_offsets[ordinal], entries + forward_offsets[ordinal + 1]};
+}
+
+void SearchServer::SortByTerm(std::vector<TermFrequency>& term_freqs) {
+    std::sort(term_freqs.begin(), term_freqs.end(), [](const TermFrequency& lhs, const TermFrequency& rhs) {
+        return lhs.term < rhs.term;
+    });
+}
+
+std::vector<DocumentOrdinal> SearchServer::ComputeCompactedOrdinals() const {
+    std::vector<DocumentOrdinal> new_ordinals(documents_.size(), REMOVED_ORDINAL);
+    DocumentOrdinal live_count = 0;
+    for (DocumentOrdinal ordinal = 0; ordinal < documents_.size(); ++ordinal) {
+        if (!documents_[ordinal].is_removed) {
+            new_ordinals[ordinal] = live_count++;
+        }
+    }
+    return new_ordinals;
+}
+
+void SearchServer::ExcludeMinusWords(const Query& query, ScoreAccumulator& accumulator) const {
+    for (const TermId word : query.minus_words) {
+        INSTRUMENT_STAGE(QueryStage::POSTING_TRAVERSAL);
+        INSTRUMENT_COUNT(QueryCounter::POSTINGS, GetPostings(word).GetDocumentFreq());
+        GetPostings(word).ForEach([&accumulator](DocumentOrdinal ordinal, double) {
+            accumulator.Exclude(ordinal);
+        });
+    }
+}
+
+std::vector<Document> SearchServer::CollectDocuments(const ScoreAccumulator& accumulator) const {
+    INSTRUMENT_STAGE(QueryStage::SCORING);
+    std::vector<Document> matched_documents;
+    const DocumentData* documents = GetDocuments();
+    accumulator.ForEachScore([documents, &matched_documents](DocumentOrdinal ordinal, double relevance) {
+        const auto& document_data = documents[ordinal];
+        matched_documents.push_back({ document_data.id, relevance, document_data.rating });
+    });
+    return matched_documents;
 }
@@ -4,18 +4,47 @@
 #include <math.h>
 #include <set>
 #include <map>
+#include <memory>
 #include <algorithm>
+#include <exception>
 #include <execution>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 #include "document.h"
+#include "forward_index.h"
+#include "instrumentation.h"
 #include "string_processing.h"
-#include "concurrent_map.h"
-//#include "log_duration.h"
-
+#include "posting_list.h"
+#include "query_result_cache.h"
+#include "score_accumulator.h"
+#include "small_vector.h"
+#include "stop_word_set.h"
+#include "term_dictionary.h"
+#include "text_arena.h"
+
+// Default number of documents returned by FindTopDocuments
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 const double PRECISION = 1e-6;
-const size_t CONCURENT_MAP_BUCKET_COUNT = 100;
+// Dynamic pruning pays only for short sequential queries. With more words the
+// threshold seldom rises above the bounds of the remaining words, so almost every
+// posting is scored anyway and the cursor bookkeeping comes on top: pruned 70-word
+// queries ran 4 to 9 times slower than full scoring, on Zipf corpora and on
+// the uniform corpus of main.cpp alike. Longer queries and parallel ones score
+// every posting, the pruned path is not meant for them
+const size_t PRUNING_MAX_QUERY_WORDS = 8;
+// Words of each kind a parsed query holds without allocating
+const size_t QUERY_INLINE_WORD_COUNT = 8;
+
+// Removes the predicate overloads of FindTopDocuments unless DocumentPredicate can be
+// called like a predicate, so that an integer top_k picks the top_k overloads
+template <typename DocumentPredicate>
+using EnableIfDocumentPredicate =
+        std::enable_if_t<std::is_invocable_r_v<bool, DocumentPredicate&, int, DocumentStatus, int>, int>;
 
 class SearchServer {
 
@@ -27,10 +56,27 @@ public:
     explicit SearchServer(const std::string&);
     explicit SearchServer(std::string_view);
 
+    // The copy owns its index and texts. Its result cache starts empty with the same
+    // capacity, and prepared queries of the original are parsed again on it
+    SearchServer(const SearchServer& other);
+    SearchServer(SearchServer&& other) = default;
+
     void AddDocument(int, const std::string_view, DocumentStatus, const std::vector<int>&);
 
+    // Index of the first document AddDocuments would reject and the exception it would
+    // throw, without adding anything. documents.size() and no exception when all are valid
+    std::pair<size_t, std::exception_ptr> FindFirstInvalidDocument(const std::vector<NewDocument>& documents) const;
+
+    // Adds the whole batch as if by AddDocument in the batch order. Throws the exception
+    // AddDocument would throw for the first invalid document and adds nothing then.
+    // Every posting list is appended to once, the parallel version also tokenizes
+    // the documents concurrently
+    void AddDocuments(const std::vector<NewDocument>& documents);
+    void AddDocuments(std::execution::sequenced_policy policy, const std::vector<NewDocument>& documents);
+    void AddDocuments(std::execution::parallel_policy policy, const std::vector<NewDocument>& documents);
+
     inline int GetDocumentCount() const noexcept{
-        return documents_.size();
+        return document_ordinals_.size();
     }
 
     const std::set<int>::const_iterator begin() const {
@@ -43,23 +89,72 @@ public:
     }
 
     ////FindTopDocuments
-    template <typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const;
+    // top_k limits the number of returned documents, the best ones come first
+    template <typename DocumentPredicate, EnableIfDocumentPredicate<DocumentPredicate> = 0>
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    template <class ExecutionPolicy, typename DocumentPredicate>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy&&, std::string_view raw_query, DocumentPredicate document_predicate) const;
+    template <class ExecutionPolicy, typename DocumentPredicate, EnableIfDocumentPredicate<DocumentPredicate> = 0>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&&, std::string_view raw_query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(std::string_view, DocumentStatus) const;
+    std::vector<Document> FindTopDocuments(std::string_view, DocumentStatus, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
     template <class ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(ExecutionPolicy&&, std::string_view, DocumentStatus) const;
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&&, std::string_view, DocumentStatus,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
-    std::vector<Document> FindTopDocuments(std::string_view) const;
+    std::vector<Document> FindTopDocuments(std::string_view, size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
 
     //template <class ExecutionPolicy>
-    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy, std::string_view) const;
+    std::vector<Document> FindTopDocuments(std::execution::sequenced_policy, std::string_view,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    std::vector<Document> FindTopDocuments(std::execution::parallel_policy, std::string_view,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Answers to a batch of queries. Identical queries share one answer,
+    // the answer to query i is results[result_indexes[i]]
+    struct BatchResults {
+        std::vector<std::vector<Document>> results;
+        std::vector<size_t> result_indexes;
+    };
+
+    // Answers every query as FindTopDocuments(query, status, top_k) would. All queries
+    // are parsed before any is scored, so an invalid one throws before any work is done.
+    // Distinct queries run in parallel, the ones sharing their longest posting list back to back
+    BatchResults FindTopDocumentsBatch(const std::vector<std::string>& raw_queries,
+                                       DocumentStatus status = DocumentStatus::ACTUAL,
+                                       size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Numbers behind the IDF of the plus words of a query. A server holding a part of
+    // a collection ranks like a server holding all of it when it scores with
+    // the statistics summed over all parts
+    struct QueryStatistics {
+        int document_count = 0;
+        // Documents containing each plus word
+        std::map<std::string, int, std::less<>> document_freqs;
+
+        void Merge(const QueryStatistics& other) {
+            document_count += other.document_count;
+            for (const auto& [word, document_freq] : other.document_freqs) {
+                document_freqs[word] += document_freq;
+            }
+        }
+    };
 
-    std::vector<Document> FindTopDocuments(std::execution::parallel_policy, std::string_view) const;
+    // Statistics of this server for the query. Throws for an invalid query
+    // like FindTopDocuments
+    QueryStatistics GetQueryStatistics(std::string_view raw_query) const;
+
+    // FindTopDocuments with IDF computed from the statistics of a larger collection.
+    // Words missing from the statistics keep the IDF of this server. The cache is not used
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, const QueryStatistics& statistics,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Relevance first, rating breaks ties within PRECISION
+    static bool IsMoreRelevant(const Document& lhs, const Document& rhs);
 
     ////MatchDocument
     using GigaChadMatchDoc = std::tuple<std::vector<std::string_view>, DocumentStatus>;
@@ -68,53 +163,312 @@ public:
     GigaChadMatchDoc MatchDocument(std::execution::parallel_policy policy, const std::string_view raw_query, int document_id) const;
 
 
-    const std::map<std::string_view, double>& GetWordFrequencies(int document_id) const;
+    // Words of a document with their term frequencies, ordered by term id rather
+    // than alphabetically. A read-only view of the forward index, valid until
+    // the server changes
+    class WordFrequencies {
+    public:
+        class Iterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<std::string_view, double>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = void;
+            using reference = value_type;
+
+            Iterator(const SearchServer* server, const TermFrequency* entry)
+                    : server_(server)
+                    , entry_(entry) {
+            }
+
+            value_type operator*() const {
+                return {server_->GetWord(entry_->term), entry_->term_freq};
+            }
+
+            Iterator& operator++() {
+                ++entry_;
+                return *this;
+            }
+
+            Iterator operator++(int) {
+                Iterator previous = *this;
+                ++entry_;
+                return previous;
+            }
+
+            bool operator==(const Iterator& other) const {
+                return entry_ == other.entry_;
+            }
+
+            bool operator!=(const Iterator& other) const {
+                return entry_ != other.entry_;
+            }
+
+        private:
+            const SearchServer* server_;
+            const TermFrequency* entry_;
+        };
+
+        WordFrequencies(const SearchServer* server, TermFrequencyRange term_freqs)
+                : server_(server)
+                , term_freqs_(term_freqs) {
+        }
+
+        Iterator begin() const {
+            return {server_, term_freqs_.begin()};
+        }
+
+        Iterator end() const {
+            return {server_, term_freqs_.end()};
+        }
+
+        size_t size() const noexcept {
+            return term_freqs_.size();
+        }
+
+        bool empty() const noexcept {
+            return term_freqs_.empty();
+        }
+
+        // The same entries with term ids instead of words
+        TermFrequencyRange GetTermFrequencies() const noexcept {
+            return term_freqs_;
+        }
+
+    private:
+        const SearchServer* server_;
+        TermFrequencyRange term_freqs_;
+    };
+
+    // Empty for unknown documents
+    WordFrequencies GetWordFrequencies(int document_id) const;
 
+    // Takes time proportional to the number of words of the document. Its postings
+    // are left in place as tombstones that queries skip until Compact is called
     void RemoveDocument(int document_id);
     void RemoveDocument(std::execution::sequenced_policy policy, int document_id);
     void RemoveDocument(std::execution::parallel_policy policy, int document_id);
 
+    // Keeps up to capacity recent answers of FindTopDocuments by status, keyed by the parsed
+    // query, so reordered and repeated words share an answer. Queries with a custom predicate
+    // are not cached. Changes of the index make the cached answers stale without flushing
+    // them. Zero capacity, the default, turns the cache off
+    void SetResultCacheCapacity(size_t capacity);
+
+    // Null while the cache is off
+    const QueryResultCache* GetResultCache() const noexcept;
+
+    // Reclaims the postings and document slots left by removed documents.
+    // Runs over the whole index, so call it after a batch of removals
+    void Compact();
+
+    // COMPRESSED postings take several times less memory at the cost of
+    // term frequencies rounded to single precision. Existing lists are converted
+    void SetPostingFormat(PostingList::Format format);
+
+    // Writes the index, without removed documents, to a versioned binary file.
+    // Throws std::runtime_error when the file can not be written
+    void SaveSnapshot(const std::string& path) const;
+
+    // Serves queries straight from a memory-mapped snapshot written by SaveSnapshot.
+    // Only the document id sets are built on opening. The returned server is
+    // read-only, its modifying methods throw std::logic_error.
+    // Throws std::runtime_error for a file of another version, or one whose sections,
+    // offsets or ranges do not fit it. The postings and word lists inside the ranges are
+    // not checked, so a snapshot has to come from a trusted writer
+    static SearchServer OpenSnapshot(const std::string& path);
+
 private:
 
+    // Trivially copyable, so that snapshots store the array as is
     struct DocumentData {
+        int id;
         int rating;
         DocumentStatus status;
-        std::string text;
+        bool is_removed = false;
     };
 
+    // Sections of an opened snapshot, defined in search_server.cpp
+    struct MappedIndex;
+
     struct QueryWord {
         std::string_view data;
         bool is_minus;
         bool is_stop;
     };
 
+    // Words unknown to the index can not match anything, so they are dropped
     struct Query {
-        std::vector<std::string_view> plus_words;
-        std::vector<std::string_view> minus_words;
+        SmallVector<TermId, QUERY_INLINE_WORD_COUNT> plus_words;
+        SmallVector<TermId, QUERY_INLINE_WORD_COUNT> minus_words;
+        // IDF of every plus word. Comes from this server unless the statistics
+        // of a larger collection are given
+        SmallVector<double, QUERY_INLINE_WORD_COUNT> inverse_document_freqs;
+        // Some words were dropped as unknown to the index
+        bool has_unknown_words = false;
+    };
+
+public:
+    // A query parsed once by PrepareQuery and run any number of times. Holds the term ids
+    // of the words, so running it takes no tokenizing, stop word or dictionary lookups,
+    // and no allocation for queries of up to QUERY_INLINE_WORD_COUNT plus and minus words.
+    // IDF follows the changes of the index. The query is parsed anew when run against
+    // another server or once new documents may have brought in words it did not know
+    class PreparedQuery {
+    public:
+        PreparedQuery() = default;
+
+        const std::string& GetText() const noexcept {
+            return text_;
+        }
+
+    private:
+        friend class SearchServer;
+
+        std::string text_;
+        Query query_;
+        uint64_t server_id_ = 0;
+        uint64_t index_epoch_ = 0;
+        // Size of the dictionary the words were looked up in
+        size_t term_count_ = 0;
     };
 
-    const TransparentStringSet stop_words_;
-    std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
-    std::map<int, std::map<std::string_view, double>> document_id_to_words_freq_ = { {-1, {} } };
-    std::map<int, DocumentData> documents_;
+    // Throws std::invalid_argument for an invalid query like FindTopDocuments
+    PreparedQuery PrepareQuery(std::string_view raw_query) const;
+
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <class ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query,
+                                           DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    // Actual documents only. top_k has no default, the overloads above cover the calls without it
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, size_t top_k) const;
+
+    template <class ExecutionPolicy>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query, size_t top_k) const;
+
+    template <typename DocumentPredicate, EnableIfDocumentPredicate<DocumentPredicate> = 0>
+    std::vector<Document> FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    template <class ExecutionPolicy, typename DocumentPredicate, EnableIfDocumentPredicate<DocumentPredicate> = 0>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query,
+                                           DocumentPredicate document_predicate,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    GigaChadMatchDoc MatchDocument(const PreparedQuery& query, int document_id) const;
+
+private:
+
+    const StopWordSet stop_words_;
+    TermDictionary terms_;
+    // Indexed by TermId
+    std::vector<PostingList> word_to_document_freqs_;
+    PostingList::Format posting_format_ = PostingList::Format::PLAIN;
+    // Logarithm of GetDocumentCount(), updated whenever a document is added or removed
+    double log_document_count_ = -std::numeric_limits<double>::infinity();
+    ForwardIndex forward_index_;
+    // Indexed by DocumentOrdinal, slots of removed documents stay in place until Compact
+    std::vector<DocumentData> documents_;
+    // Views into document_text_arena_, empty for removed documents
+    std::vector<std::string_view> document_texts_;
+    TextArena document_text_arena_;
+    std::map<int, DocumentOrdinal> document_ordinals_;
     std::set<int> document_ids_;
+    // Bumped by every change of the index that may change query results
+    uint64_t index_epoch_ = 0;
+    std::unique_ptr<QueryResultCache> result_cache_;
+    // Tells the servers apart for prepared queries
+    uint64_t server_id_ = NextServerId();
+    // Set for a server opened from a snapshot, which keeps the data above empty
+    // except for stop words and document ids
+    std::shared_ptr<const MappedIndex> mapped_index_;
+
+    explicit SearchServer(std::shared_ptr<const MappedIndex> mapped_index);
 
     static bool IsValidWord(const std::string_view);
 
+    static uint64_t NextServerId();
+
     static int ComputeAverageRating(const std::vector<int>&);
 
     bool IsStopWord(const std::string_view word) const {
-        return stop_words_.count(word) > 0;
+        return stop_words_.Contains(word);
     }
 
-    std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view) const;
+    // Fills the buffer with the words of the text except stop words. Throws
+    // std::invalid_argument for the first invalid word
+    void SplitIntoWordsNoStop(std::string_view text, std::vector<std::string_view>& words) const;
 
-    QueryWord ParseQueryWord(std::string_view text) const;
+    // Distinct words of the text with their term frequencies, sorted by word
+    std::vector<std::pair<std::string_view, double>> ComputeWordFrequencies(std::string_view text) const;
+
+    template <class ExecutionPolicy>
+    void AddDocumentBatch(ExecutionPolicy&& policy, const std::vector<NewDocument>& documents);
+
+    // is_valid_text tells that the whole query has no control characters,
+    // so the word needs no check for them
+    QueryWord ParseQueryWord(std::string_view text, bool is_valid_text = false) const;
 
     Query ParseQuery(std::string_view text, bool need_sort) const;
 
-    // Existence required
-    double ComputeWordInverseDocumentFreq(const std::string_view) const;
+    // Both logarithms are cached, so no query computes one
+    double ComputeWordInverseDocumentFreq(const PostingListView& postings) const noexcept {
+        return log_document_count_ - postings.GetLogDocumentFreq();
+    }
+
+    // Throws std::logic_error for a server opened from a snapshot
+    void CheckNotMapped() const;
+
+    // Accessors shared by the in-memory and the mapped index
+    TermId FindTerm(std::string_view word) const;
+    std::string_view GetWord(TermId term) const;
+    PostingListView GetPostings(TermId term) const;
+    TermFrequencyRange GetTermFrequencies(DocumentOrdinal ordinal) const noexcept;
+
+    static void SortByTerm(std::vector<TermFrequency>& term_freqs);
+
+    // Indexed by DocumentOrdinal, GetDocumentSlotCount() entries
+    const DocumentData* GetDocuments() const noexcept;
+    size_t GetDocumentSlotCount() const noexcept;
+
+    // Ordinals a compaction would assign, REMOVED_ORDINAL for removed documents
+    std::vector<DocumentOrdinal> ComputeCompactedOrdinals() const;
+
+    // Turns the document into a tombstone. The slot is kept so that ordinals
+    // of other documents stay valid
+    void ReleaseDocumentData(DocumentOrdinal ordinal);
+
+    void ExcludeMinusWords(const Query& query, ScoreAccumulator& accumulator) const;
+
+    template <typename DocumentPredicate>
+    void AccumulateWordScores(TermId word, double inverse_document_freq, DocumentPredicate& document_predicate,
+                              const ScoreAccumulator& excluded, ScoreAccumulator& accumulator) const;
+
+    std::vector<Document> CollectDocuments(const ScoreAccumulator& accumulator) const;
+
+    template <class ExecutionPolicy, typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(ExecutionPolicy&& policy, const Query& query,
+                                           DocumentPredicate document_predicate, size_t top_k) const;
+
+    // Answers from the result cache when it is on
+    template <class ExecutionPolicy>
+    std::vector<Document> FindTopDocumentsByStatus(ExecutionPolicy&& policy, const Query& query, DocumentStatus status,
+                                                   size_t top_k) const;
+
+    // The query of the prepared one valid for the current index. It is either
+    // the prepared query itself or one built in the buffer given
+    const Query& ResolvePreparedQuery(const PreparedQuery& prepared, Query& buffer) const;
+
+    GigaChadMatchDoc MatchDocument(const Query& query, int document_id) const;
+
+    // Block-Max WAND: skips documents whose score upper bound can not enter
+    // the current top_k. The result is unordered
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsPruned(const Query&, DocumentPredicate, size_t top_k) const;
 
     //FindAllDocuments
     template <typename DocumentPredicate>
@@ -128,103 +482,291 @@ private:
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer& stop_words)
         :stop_words_(MakeUniqueNonEmptyStrings(stop_words)){
-    if(!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord)){
+    const auto stop_word_list = stop_words_.GetWords();
+    if(!std::all_of(stop_word_list.begin(), stop_word_list.end(), IsValidWord)){
         throw std::invalid_argument("Some of stop words are invalid");
     }
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate) const
+template <typename DocumentPredicate, EnableIfDocumentPredicate<DocumentPredicate>>
+std::vector<Document> SearchServer::FindTopDocuments(std::string_view raw_query, DocumentPredicate document_predicate, size_t top_k) const
 {
-    return FindTopDocuments(std::execution::seq, raw_query, document_predicate);
+    return FindTopDocuments(std::execution::seq, raw_query, document_predicate, top_k);
 }
 
-template <class ExecutionPolicy,typename DocumentPredicate>
-std::vector<Document> SearchServer::FindTopDocuments(/*std::execution::sequenced_policy*/ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate) const {
-    auto query = ParseQuery(raw_query, true);
-
-    auto matched_documents = FindAllDocuments(/*std::execution::seq*/policy, query, document_predicate);
+template <class ExecutionPolicy, typename DocumentPredicate, EnableIfDocumentPredicate<DocumentPredicate>>
+std::vector<Document> SearchServer::FindTopDocuments(/*std::execution::sequenced_policy*/ExecutionPolicy&& policy, std::string_view raw_query, DocumentPredicate document_predicate, size_t top_k) const {
+    return FindTopDocuments(policy, ParseQuery(raw_query, true), document_predicate, top_k);
+}
 
-    sort(std::execution::seq, matched_documents.begin(), matched_documents.end(), [](const Document& lhs, const Document& rhs) {
-        if (std::abs(lhs.relevance - rhs.relevance) < PRECISION){
-            return lhs.rating > rhs.rating;
-        }
-        else {
-            return lhs.relevance > rhs.relevance;
+template <class ExecutionPolicy, typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const Query& query,
+                                                     DocumentPredicate document_predicate, size_t top_k) const {
+    INSTRUMENT_STAGE(QueryStage::QUERY);
+    std::vector<Document> matched_documents;
+    if constexpr (std::is_same_v<std::decay_t<ExecutionPolicy>, std::execution::sequenced_policy>) {
+        if (query.plus_words.size() <= PRUNING_MAX_QUERY_WORDS) {
+            matched_documents = FindTopDocumentsPruned(query, document_predicate, top_k);
+        } else {
+            matched_documents = FindAllDocuments(policy, query, document_predicate);
         }
-    });
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+    } else {
+        matched_documents = FindAllDocuments(policy, query, document_predicate);
     }
+
+    INSTRUMENT_STAGE(QueryStage::TOP_K);
+    // Only the first top_k places are ordered, the rest is dropped unsorted
+    const auto top_end = matched_documents.begin() + std::min(top_k, matched_documents.size());
+    std::partial_sort(policy, matched_documents.begin(), top_end, matched_documents.end(), IsMoreRelevant);
+    matched_documents.erase(top_end, matched_documents.end());
     return matched_documents;
 }
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const {
-    std::map<int, double> document_to_relevance;
-    for (std::string_view word : query.plus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
-        }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-            const auto& document_data = documents_.at(document_id);
-            if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
-            }
-        }
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, std::string_view raw_query, DocumentStatus status, size_t top_k) const {
+    return FindTopDocumentsByStatus(policy, ParseQuery(raw_query, true), status, top_k);
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query,
+                                                     DocumentStatus status, size_t top_k) const {
+    Query buffer;
+    return FindTopDocumentsByStatus(policy, ResolvePreparedQuery(query, buffer), status, top_k);
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query,
+                                                     size_t top_k) const {
+    return FindTopDocuments(policy, query, DocumentStatus::ACTUAL, top_k);
+}
+
+template <typename DocumentPredicate, EnableIfDocumentPredicate<DocumentPredicate>>
+std::vector<Document> SearchServer::FindTopDocuments(const PreparedQuery& query, DocumentPredicate document_predicate,
+                                                     size_t top_k) const {
+    return FindTopDocuments(std::execution::seq, query, document_predicate, top_k);
+}
+
+template <class ExecutionPolicy, typename DocumentPredicate, EnableIfDocumentPredicate<DocumentPredicate>>
+std::vector<Document> SearchServer::FindTopDocuments(ExecutionPolicy&& policy, const PreparedQuery& query,
+                                                     DocumentPredicate document_predicate, size_t top_k) const {
+    Query buffer;
+    return FindTopDocuments(policy, ResolvePreparedQuery(query, buffer), document_predicate, top_k);
+}
+
+template <class ExecutionPolicy>
+std::vector<Document> SearchServer::FindTopDocumentsByStatus(ExecutionPolicy&& policy, const Query& query,
+                                                             DocumentStatus status, size_t top_k) const {
+    const auto document_predicate = [status](int, DocumentStatus document_status, int) {
+        return document_status == status;
+    };
+    if (!result_cache_) {
+        return FindTopDocuments(policy, query, document_predicate, top_k);
     }
 
-    for (std::string_view word : query.minus_words) {
-        if (word_to_document_freqs_.count(word) == 0) {
-            continue;
+    const QueryCacheKey key{{query.plus_words.begin(), query.plus_words.end()},
+                            {query.minus_words.begin(), query.minus_words.end()},
+                            static_cast<uint32_t>(status), top_k};
+    if (auto documents = result_cache_->Find(key, index_epoch_)) {
+        return std::move(*documents);
+    }
+    auto documents = FindTopDocuments(policy, query, document_predicate, top_k);
+    result_cache_->Insert(key, index_epoch_, documents);
+    return documents;
+}
+
+template <typename DocumentPredicate>
+void SearchServer::AccumulateWordScores(TermId word, double inverse_document_freq, DocumentPredicate& document_predicate,
+                                        const ScoreAccumulator& excluded, ScoreAccumulator& accumulator) const {
+    const PostingListView postings = GetPostings(word);
+    if (postings.GetDocumentFreq() == 0) {
+        return;
+    }
+    INSTRUMENT_STAGE(QueryStage::POSTING_TRAVERSAL);
+    INSTRUMENT_COUNT(QueryCounter::POSTINGS, postings.GetDocumentFreq());
+    const DocumentData* documents = GetDocuments();
+    postings.ForEach([&, documents](DocumentOrdinal ordinal, double term_freq) {
+        if (excluded.IsExcluded(ordinal) || accumulator.IsExcluded(ordinal)) {
+            return;
         }
-        for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-            document_to_relevance.erase(document_id);
+        const auto& document_data = documents[ordinal];
+        if (document_data.is_removed) {
+            return;
         }
-    }
+        if (CallInstrumentedPredicate(document_predicate, document_data.id, document_data.status, document_data.rating)) {
+            accumulator.Add(ordinal, term_freq * inverse_document_freq);
+        } else {
+            // Rejected documents are not offered to the predicate again
+            accumulator.Exclude(ordinal);
+        }
+    });
+}
 
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindAllDocuments(std::execution::sequenced_policy, const Query& query, DocumentPredicate document_predicate) const {
+    ScoreAccumulator::Lease accumulator(GetDocumentSlotCount());
+    ExcludeMinusWords(query, *accumulator);
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        AccumulateWordScores(query.plus_words[i], query.inverse_document_freqs[i], document_predicate,
+                             *accumulator, *accumulator);
     }
-    return matched_documents;
+    return CollectDocuments(*accumulator);
 }
 
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindAllDocuments(std::execution::parallel_policy, const Query& query, DocumentPredicate document_predicate) const {
-    ConcurrentMap<int, double> document_to_relevance(CONCURENT_MAP_BUCKET_COUNT);{
-        for_each(std::execution::par,
-                 query.plus_words.begin(), query.plus_words.end(),
-                 [this, &document_to_relevance, &document_predicate](const std::string_view word) {
-                     auto it = word_to_document_freqs_.find(word);
-                     if (it == word_to_document_freqs_.end()) {
-                         return;
-                     }
-                     const double inverse_document_freq = ComputeWordInverseDocumentFreq(std::string{ word });
-                     for (const auto [document_id, term_freq] : word_to_document_freqs_.at(word)) {
-                         const auto& document_data = documents_.at(document_id);
-                         if (document_predicate(document_id, document_data.status, document_data.rating)) {
-                             document_to_relevance[document_id].ref_to_value += term_freq * inverse_document_freq;
-                         }
-                     }
+    ScoreAccumulator::Lease accumulator(GetDocumentSlotCount());
+    ExcludeMinusWords(query, *accumulator);
+
+    // Every chunk of plus words is scored into an accumulator of the worker thread,
+    // the partial scores are then summed up without any locking
+    const size_t chunk_count = std::min<size_t>(query.plus_words.size(), std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::vector<std::pair<DocumentOrdinal, double>>> partial_scores(chunk_count);
+    std::vector<size_t> chunks(chunk_count);
+    std::iota(chunks.begin(), chunks.end(), 0);
+    const ScoreAccumulator& excluded = *accumulator;
+    for_each(std::execution::par,
+             chunks.begin(), chunks.end(),
+             [this, &query, &document_predicate, &excluded, &partial_scores, chunk_count](size_t chunk) {
+                 ScoreAccumulator::Lease local_accumulator(GetDocumentSlotCount());
+                 for (size_t i = chunk; i < query.plus_words.size(); i += chunk_count) {
+                     AccumulateWordScores(query.plus_words[i], query.inverse_document_freqs[i], document_predicate,
+                                          excluded, *local_accumulator);
+                 }
+                 local_accumulator->ForEachScore([&scores = partial_scores[chunk]](DocumentOrdinal ordinal, double score) {
+                     scores.emplace_back(ordinal, score);
                  });
-    }
+             });
 
     {
-        for_each (std::execution::par, query.minus_words.begin(), query.minus_words.end(),
-               [this, &document_to_relevance, &document_predicate](const std::string_view word){
-                   auto it = word_to_document_freqs_.find(word);
-                   if (word_to_document_freqs_.count(word) == 0) {
-                       for (const auto [document_id, _] : word_to_document_freqs_.at(word)) {
-                           document_to_relevance.Erase(document_id);
-                      }
-                   }
-               }
-    );}
-    std::vector<Document> matched_documents;
-    for (const auto [document_id, relevance] : document_to_relevance.BuildOrdinaryMap()) {
-        matched_documents.push_back({ document_id, relevance, documents_.at(document_id).rating });
+        INSTRUMENT_STAGE(QueryStage::SCORING);
+        for (const auto& scores : partial_scores) {
+            for (const auto& [ordinal, score] : scores) {
+                accumulator->Add(ordinal, score);
+            }
+        }
     }
-    return matched_documents;
+    return CollectDocuments(*accumulator);
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsPruned(const Query& query, DocumentPredicate document_predicate, size_t top_k) const {
+    std::vector<Document> top_documents;
+    if (top_k == 0) {
+        return top_documents;
+    }
+    ScoreAccumulator::Lease excluded(GetDocumentSlotCount());
+    ExcludeMinusWords(query, *excluded);
+    const DocumentData* documents = GetDocuments();
+
+    struct TermCursor {
+        PostingListView::Cursor cursor;
+        double inverse_document_freq;
+        double max_score;
+    };
+    std::vector<TermCursor> term_cursors;
+    term_cursors.reserve(query.plus_words.size());
+    for (size_t i = 0; i < query.plus_words.size(); ++i) {
+        const PostingListView postings = GetPostings(query.plus_words[i]);
+        if (postings.GetDocumentFreq() == 0) {
+            continue;
+        }
+        const double inverse_document_freq = query.inverse_document_freqs[i];
+        term_cursors.push_back({PostingListView::Cursor(postings), inverse_document_freq,
+                                postings.GetMaxTermFreq() * inverse_document_freq});
+    }
+    std::vector<TermCursor*> cursors;
+    for (TermCursor& term_cursor : term_cursors) {
+        cursors.push_back(&term_cursor);
+    }
+    const auto by_ordinal = [](const TermCursor* lhs, const TermCursor* rhs) {
+        return lhs->cursor.GetOrdinal() < rhs->cursor.GetOrdinal();
+    };
+    std::sort(cursors.begin(), cursors.end(), by_ordinal);
+    // Moves the advanced prefix of cursors back into ordinal order
+    const auto restore_order = [&cursors, &by_ordinal](size_t moved_count) {
+        for (size_t i = moved_count; i-- > 0;) {
+            for (size_t j = i; j + 1 < cursors.size() && by_ordinal(cursors[j + 1], cursors[j]); ++j) {
+                std::swap(cursors[j], cursors[j + 1]);
+            }
+        }
+    };
+
+    INSTRUMENT_STAGE(QueryStage::POSTING_TRAVERSAL);
+    // Documents scoring not above the threshold can not displace the worst of the top.
+    // Twice the PRECISION keeps ties decided by rating and rounding of the bounds safe
+    double threshold = -std::numeric_limits<double>::infinity();
+    while (true) {
+        size_t pivot = 0;
+        double bound = 0.0;
+        for (; pivot < cursors.size() && !cursors[pivot]->cursor.IsEnd(); ++pivot) {
+            bound += cursors[pivot]->max_score;
+            if (bound > threshold) {
+                break;
+            }
+        }
+        if (pivot == cursors.size() || cursors[pivot]->cursor.IsEnd()) {
+            break;
+        }
+        const DocumentOrdinal pivot_ordinal = cursors[pivot]->cursor.GetOrdinal();
+        while (pivot + 1 < cursors.size() && cursors[pivot + 1]->cursor.GetOrdinal() == pivot_ordinal) {
+            ++pivot;
+        }
+
+        // Refine the bound with the blocks that may hold the pivot
+        double block_bound = 0.0;
+        DocumentOrdinal next_ordinal = pivot + 1 < cursors.size()
+                ? cursors[pivot + 1]->cursor.GetOrdinal()
+                : PostingListView::Cursor::END;
+        for (size_t i = 0; i <= pivot; ++i) {
+            PostingListView::Cursor& cursor = cursors[i]->cursor;
+            if (!cursor.ShallowSkipTo(pivot_ordinal)) {
+                continue;
+            }
+            block_bound += cursor.GetBlockMaxTermFreq() * cursors[i]->inverse_document_freq;
+            next_ordinal = std::min(next_ordinal, cursor.GetBlockLastOrdinal() + 1);
+        }
+        if (block_bound <= threshold) {
+            for (size_t i = 0; i <= pivot; ++i) {
+                cursors[i]->cursor.SkipTo(next_ordinal);
+            }
+            restore_order(pivot + 1);
+            continue;
+        }
+
+        if (cursors[0]->cursor.GetOrdinal() != pivot_ordinal) {
+            for (size_t i = 0; i < pivot; ++i) {
+                cursors[i]->cursor.SkipTo(pivot_ordinal);
+            }
+            restore_order(pivot);
+            continue;
+        }
+
+        double relevance = 0.0;
+        for (size_t i = 0; i <= pivot; ++i) {
+            relevance += cursors[i]->cursor.GetTermFreq() * cursors[i]->inverse_document_freq;
+            cursors[i]->cursor.Next();
+        }
+        restore_order(pivot + 1);
+        if (excluded->IsExcluded(pivot_ordinal)) {
+            continue;
+        }
+        const auto& document_data = documents[pivot_ordinal];
+        if (document_data.is_removed
+            || !CallInstrumentedPredicate(document_predicate, document_data.id, document_data.status, document_data.rating)) {
+            continue;
+        }
+        const Document document{document_data.id, relevance, document_data.rating};
+        if (top_documents.size() < top_k) {
+            top_documents.push_back(document);
+            std::push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+        } else if (IsMoreRelevant(document, top_documents.front())) {
+            std::pop_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+            top_documents.back() = document;
+            std::push_heap(top_documents.begin(), top_documents.end(), IsMoreRelevant);
+        }
+        if (top_documents.size() == top_k) {
+            threshold = top_documents.front().relevance - 2 * PRECISION;
+        }
+    }
+    return top_documents;
 }
@@ -0,0 +1,303 @@
+#include "shard_coordinator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "sharded_search_server.h"
+
+namespace {
+
+void WriteDocument(MessageWriter& request, int document_id, std::string_view document, DocumentStatus status,
+                   const std::vector<int>& ratings) {
+    request.WriteInt32(document_id);
+    request.WriteString(document);
+    request.WriteStatus(status);
+    request.WriteUint32(static_cast<uint32_t>(ratings.size()));
+    for (const int rating : ratings) {
+        request.WriteInt32(rating);
+    }
+}
+
+} // namespace
+
+ShardClient::ShardClient(const std::string& socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + socket_path);
+    }
+    std::copy(socket_path.begin(), socket_path.end(), address.sun_path);
+    socket_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (socket_fd_ < 0) {
+        throw std::runtime_error(std::string("Can not create socket: ") + std::strerror(errno));
+    }
+    if (connect(socket_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        const std::string error = std::strerror(errno);
+        close(socket_fd_);
+        throw std::runtime_error("Can not connect to shard " + socket_path + ": " + error);
+    }
+}
+
+ShardClient::~ShardClient() {
+    Disconnect();
+}
+
+ShardClient::ShardClient(ShardClient&& other) noexcept
+        : socket_fd_(other.socket_fd_) {
+    other.socket_fd_ = -1;
+}
+
+void ShardClient::Send(const MessageWriter& request) {
+    if (IsBroken()) {
+        throw std::runtime_error("Shard connection is broken");
+    }
+    try {
+        SendMessage(socket_fd_, request.GetPayload());
+    } catch (...) {
+        Disconnect();
+        throw;
+    }
+}
+
+std::string ShardClient::Receive() {
+    if (IsBroken()) {
+        throw std::runtime_error("Shard connection is broken");
+    }
+    std::string response;
+    try {
+        response = ReadMessage(socket_fd_);
+    } catch (...) {
+        Disconnect();
+        throw;
+    }
+    MessageReader reader(response);
+    const auto status = static_cast<ShardResponse>(reader.ReadUint8());
+    if (status == ShardResponse::OK) {
+        return response.substr(1);
+    }
+    if (status == ShardResponse::INVALID_DOCUMENT) {
+        const uint32_t index = reader.ReadUint32();
+        throw InvalidDocumentError(index, std::string(reader.ReadString()));
+    }
+    const std::string message(reader.ReadString());
+    if (status == ShardResponse::INVALID_ARGUMENT) {
+        throw std::invalid_argument(message);
+    }
+    if (status == ShardResponse::OUT_OF_RANGE) {
+        throw std::out_of_range(message);
+    }
+    throw std::runtime_error("Shard failed: " + message);
+}
+
+void ShardClient::Disconnect() noexcept {
+    if (socket_fd_ >= 0) {
+        close(socket_fd_);
+        socket_fd_ = -1;
+    }
+}
+
+ShardCoordinator::ShardCoordinator(const std::vector<std::string>& socket_paths) {
+    if (socket_paths.empty()) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    shards_.reserve(socket_paths.size());
+    for (const std::string& socket_path : socket_paths) {
+        shards_.emplace_back(socket_path);
+    }
+}
+
+void ShardCoordinator::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                   const std::vector<int>& ratings) {
+    MessageWriter request;
+    request.WriteUint8(static_cast<uint8_t>(ShardRequest::ADD_DOCUMENT));
+    WriteDocument(request, document_id, document, status, ratings);
+    ShardClient& shard = shards_[GetDocumentShard(document_id, shards_.size())];
+    shard.Send(request);
+    shard.Receive();
+}
+
+void ShardCoordinator::AddDocuments(const std::vector<NewDocument>& documents) {
+    std::vector<std::vector<const NewDocument*>> shard_documents(shards_.size());
+    // Index in the batch of every document of a part
+    std::vector<std::vector<size_t>> batch_indexes(shards_.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const size_t shard = GetDocumentShard(documents[i].id, shards_.size());
+        shard_documents[shard].push_back(&documents[i]);
+        batch_indexes[shard].push_back(i);
+    }
+    // Equal ids share a shard, so the rejected document first in the batch is the one
+    // SearchServer::AddDocuments reports. Other errors count only when no document is rejected
+    std::exception_ptr error;
+    // Shards past a failed send get nothing, the ones before it may add their parts
+    size_t sent_count = 0;
+    for (; sent_count < shards_.size(); ++sent_count) {
+        MessageWriter request;
+        request.WriteUint8(static_cast<uint8_t>(ShardRequest::ADD_DOCUMENTS));
+        request.WriteUint32(static_cast<uint32_t>(shard_documents[sent_count].size()));
+        for (const NewDocument* document : shard_documents[sent_count]) {
+            WriteDocument(request, document->id, document->text, document->status, document->ratings);
+        }
+        try {
+            shards_[sent_count].Send(request);
+        } catch (...) {
+            error = std::current_exception();
+            break;
+        }
+    }
+
+    size_t first_invalid_index = documents.size();
+    std::vector<size_t> added_shards;
+    for (size_t shard = 0; shard < sent_count; ++shard) {
+        try {
+            shards_[shard].Receive();
+            added_shards.push_back(shard);
+        } catch (const InvalidDocumentError& e) {
+            const size_t index = batch_indexes[shard].at(e.GetIndex());
+            if (index < first_invalid_index) {
+                first_invalid_index = index;
+                error = std::make_exception_ptr(std::invalid_argument(e.what()));
+            }
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (!error) {
+        return;
+    }
+
+    // A shard adds its part completely or not at all, so the parts the other shards
+    // have added are removed again. The rollback is best effort, its own failures
+    // are dropped in favour of the error of the batch
+    std::vector<size_t> removing_shards;
+    for (const size_t shard : added_shards) {
+        MessageWriter request;
+        request.WriteUint8(static_cast<uint8_t>(ShardRequest::REMOVE_DOCUMENTS));
+        request.WriteUint32(static_cast<uint32_t>(shard_documents[shard].size()));
+        for (const NewDocument* document : shard_documents[shard]) {
+            request.WriteInt32(document->id);
+        }
+        try {
+            shards_[shard].Send(request);
+            removing_shards.push_back(shard);
+        } catch (...) {
+        }
+    }
+    for (const size_t shard : removing_shards) {
+        try {
+            shards_[shard].Receive();
+        } catch (...) {
+        }
+    }
+    std::rethrow_exception(error);
+}
+
+void ShardCoordinator::RemoveDocument(int document_id) {
+    MessageWriter request;
+    request.WriteUint8(static_cast<uint8_t>(ShardRequest::REMOVE_DOCUMENT));
+    request.WriteInt32(document_id);
+    ShardClient& shard = shards_[GetDocumentShard(document_id, shards_.size())];
+    shard.Send(request);
+    shard.Receive();
+}
+
+ShardCoordinator::MatchedDocument ShardCoordinator::MatchDocument(std::string_view raw_query, int document_id) {
+    MessageWriter request;
+    request.WriteUint8(static_cast<uint8_t>(ShardRequest::MATCH_DOCUMENT));
+    request.WriteString(raw_query);
+    request.WriteInt32(document_id);
+    ShardClient& shard = shards_[GetDocumentShard(document_id, shards_.size())];
+    shard.Send(request);
+    const std::string response = shard.Receive();
+    MessageReader reader(response);
+    const DocumentStatus status = reader.ReadStatus();
+    std::vector<std::string> words(reader.ReadCount(sizeof(uint32_t)));
+    for (std::string& word : words) {
+        word = reader.ReadString();
+    }
+    return {std::move(words), status};
+}
+
+std::vector<Document> ShardCoordinator::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                         size_t top_k) {
+    MessageWriter statistics_request;
+    statistics_request.WriteUint8(static_cast<uint8_t>(ShardRequest::GET_QUERY_STATISTICS));
+    statistics_request.WriteString(raw_query);
+    SearchServer::QueryStatistics statistics;
+    for (const std::string& response : Broadcast(statistics_request)) {
+        statistics.Merge(MessageReader(response).ReadStatistics());
+    }
+
+    MessageWriter request;
+    request.WriteUint8(static_cast<uint8_t>(ShardRequest::FIND_TOP_DOCUMENTS));
+    request.WriteString(raw_query);
+    request.WriteStatus(status);
+    // No shard holds more documents than the 32-bit count can tell, so the clamp loses nothing
+    request.WriteUint32(static_cast<uint32_t>(std::min<size_t>(top_k, std::numeric_limits<uint32_t>::max())));
+    request.WriteStatistics(statistics);
+    // Every shard returns its own best top_k, so the overall best are among them
+    std::vector<Document> documents;
+    for (const std::string& response : Broadcast(request)) {
+        const std::vector<Document> shard_documents = MessageReader(response).ReadDocuments();
+        documents.insert(documents.end(), shard_documents.begin(), shard_documents.end());
+    }
+    const auto top_end = documents.begin() + std::min(top_k, documents.size());
+    std::partial_sort(documents.begin(), top_end, documents.end(), SearchServer::IsMoreRelevant);
+    documents.erase(top_end, documents.end());
+    return documents;
+}
+
+int ShardCoordinator::GetDocumentCount() {
+    MessageWriter request;
+    request.WriteUint8(static_cast<uint8_t>(ShardRequest::GET_DOCUMENT_COUNT));
+    int document_count = 0;
+    for (const std::string& response : Broadcast(request)) {
+        document_count += MessageReader(response).ReadInt32();
+    }
+    return document_count;
+}
+
+std::vector<std::string> ShardCoordinator::Broadcast(const MessageWriter& request) {
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        try {
+            shards_[shard].Send(request);
+        } catch (...) {
+            DiscardResponses(shard);
+            throw;
+        }
+    }
+    std::vector<std::string> responses(shards_.size());
+    std::exception_ptr error;
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        try {
+            responses[shard] = shards_[shard].Receive();
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return responses;
+}
+
+void ShardCoordinator::DiscardResponses(size_t shard_count) {
+    for (size_t shard = 0; shard < shard_count; ++shard) {
+        try {
+            shards_[shard].Receive();
+        } catch (...) {
+        }
+    }
+}
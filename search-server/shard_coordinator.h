@@ -0,0 +1,107 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+#include "shard_protocol.h"
+
+// Thrown by ShardClient::Receive when a shard rejects a document of an ADD_DOCUMENTS request
+class InvalidDocumentError : public std::invalid_argument {
+public:
+    InvalidDocumentError(size_t index, const std::string& message)
+            : std::invalid_argument(message)
+            , index_(index) {
+    }
+
+    // Index of the document in the request
+    size_t GetIndex() const noexcept {
+        return index_;
+    }
+
+private:
+    size_t index_;
+};
+
+// Connection to a shard process
+class ShardClient {
+public:
+    // Throws std::runtime_error when the shard does not accept the connection
+    explicit ShardClient(const std::string& socket_path);
+    ~ShardClient();
+
+    ShardClient(ShardClient&& other) noexcept;
+    ShardClient& operator=(ShardClient&& other) = delete;
+    ShardClient(const ShardClient&) = delete;
+    ShardClient& operator=(const ShardClient&) = delete;
+
+    // Sends the request without waiting for the response, so that requests
+    // to several shards are served at the same time
+    void Send(const MessageWriter& request);
+
+    // Waits for the response to the oldest request sent and returns its payload
+    // after the status. Rethrows the errors of the shard, InvalidDocumentError for
+    // rejected documents, std::invalid_argument for other invalid arguments,
+    // std::out_of_range for unknown ids and std::runtime_error for the rest
+    std::string Receive();
+
+    // A failed send or receive may leave a message half way through the stream, so the
+    // connection is closed then and every later call throws std::runtime_error
+    bool IsBroken() const noexcept {
+        return socket_fd_ < 0;
+    }
+
+private:
+    int socket_fd_ = -1;
+
+    void Disconnect() noexcept;
+};
+
+// Serves a collection split between shard processes, each holding the documents
+// whose id hashes to it, like ShardedSearchServer does in one process. Queries
+// are scored with statistics gathered from all shards, so they rank like a single
+// SearchServer. Not safe to use from several threads at once
+class ShardCoordinator {
+public:
+    // Connects to the shards in the order given, which must stay the same
+    // for the lifetime of their documents
+    explicit ShardCoordinator(const std::vector<std::string>& socket_paths);
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Throws the exception SearchServer::AddDocuments would throw for the first invalid
+    // document and adds nothing then
+    void AddDocuments(const std::vector<NewDocument>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Like SearchServer::MatchDocument, but the words are copies, as the index
+    // they come from is in another process
+    using MatchedDocument = std::tuple<std::vector<std::string>, DocumentStatus>;
+    MatchedDocument MatchDocument(std::string_view raw_query, int document_id);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT);
+
+    int GetDocumentCount();
+
+    size_t GetShardCount() const noexcept {
+        return shards_.size();
+    }
+
+private:
+    std::vector<ShardClient> shards_;
+
+    // Sends the request to every shard and returns the responses in shard order.
+    // All responses are read before the first error is rethrown, so that every
+    // connection stays in step
+    std::vector<std::string> Broadcast(const MessageWriter& request);
+
+    // Reads and drops the responses of the first shard_count shards, which got a request
+    // that has failed on a later shard
+    void DiscardResponses(size_t shard_count);
+};
@@ -0,0 +1,50 @@
+#include "search_server.h"
+#include "shard_server.h"
+
+#include <csignal>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include <pthread.h>
+
+using namespace std;
+
+// Shard process: serves one index on a Unix domain socket until SIGINT or SIGTERM.
+//   search_shard SOCKET_PATH [STOP_WORDS]      starts with an empty index
+//   search_shard SOCKET_PATH --snapshot FILE   serves a snapshot read-only
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 4 || (argc == 4 && string(argv[2]) != "--snapshot")) {
+        cerr << "Usage: " << argv[0] << " SOCKET_PATH [STOP_WORDS | --snapshot FILE]" << endl;
+        return 2;
+    }
+    // Blocked before any thread starts, so that every thread inherits the mask
+    // and the signals are only taken by sigwait below
+    sigset_t stop_signals;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stop_signals, nullptr);
+
+    try {
+        optional<SearchServer> search_server;
+        if (argc == 4) {
+            search_server.emplace(SearchServer::OpenSnapshot(argv[3]));
+        } else {
+            search_server.emplace(string(argc == 3 ? argv[2] : ""));
+        }
+        ShardServer shard_server(*search_server, argv[1]);
+        thread serving_thread([&shard_server] {
+            shard_server.Run();
+        });
+        int signal_number;
+        sigwait(&stop_signals, &signal_number);
+        shard_server.Stop();
+        serving_thread.join();
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "shard_protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+
+namespace {
+
+// Larger messages are treated as a broken stream
+const uint32_t MAX_MESSAGE_SIZE = 1u << 30;
+
+void SendBytes(int socket_fd, const char* data, size_t size) {
+    while (size > 0) {
+        // MSG_NOSIGNAL reports a closed peer as EPIPE instead of killing the process
+        const ssize_t sent = send(socket_fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Shard connection failed: ") + std::strerror(errno));
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+}
+
+void ReceiveBytes(int socket_fd, char* data, size_t size) {
+    while (size > 0) {
+        const ssize_t received = recv(socket_fd, data, size, 0);
+        if (received < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Shard connection failed: ") + std::strerror(errno));
+        }
+        if (received == 0) {
+            throw std::runtime_error("Shard connection closed");
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+}
+
+} // namespace
+
+void MessageWriter::WriteUint8(uint8_t value) {
+    WriteBytes(&value, sizeof(value));
+}
+
+void MessageWriter::WriteInt32(int32_t value) {
+    WriteBytes(&value, sizeof(value));
+}
+
+void MessageWriter::WriteUint32(uint32_t value) {
+    WriteBytes(&value, sizeof(value));
+}
+
+void MessageWriter::WriteDouble(double value) {
+    WriteBytes(&value, sizeof(value));
+}
+
+void MessageWriter::WriteString(std::string_view value) {
+    WriteUint32(static_cast<uint32_t>(value.size()));
+    WriteBytes(value.data(), value.size());
+}
+
+void MessageWriter::WriteStatus(DocumentStatus status) {
+    WriteUint8(static_cast<uint8_t>(status));
+}
+
+void MessageWriter::WriteDocuments(const std::vector<Document>& documents) {
+    WriteUint32(static_cast<uint32_t>(documents.size()));
+    for (const Document& document : documents) {
+        WriteInt32(document.id);
+        WriteDouble(document.relevance);
+        WriteInt32(document.rating);
+    }
+}
+
+void MessageWriter::WriteStatistics(const SearchServer::QueryStatistics& statistics) {
+    WriteInt32(statistics.document_count);
+    WriteUint32(static_cast<uint32_t>(statistics.document_freqs.size()));
+    for (const auto& [word, document_freq] : statistics.document_freqs) {
+        WriteString(word);
+        WriteInt32(document_freq);
+    }
+}
+
+void MessageWriter::WriteBytes(const void* data, size_t size) {
+    payload_.append(static_cast<const char*>(data), size);
+}
+
+uint8_t MessageReader::ReadUint8() {
+    uint8_t value;
+    ReadBytes(&value, sizeof(value));
+    return value;
+}
+
+int32_t MessageReader::ReadInt32() {
+    int32_t value;
+    ReadBytes(&value, sizeof(value));
+    return value;
+}
+
+uint32_t MessageReader::ReadUint32() {
+    uint32_t value;
+    ReadBytes(&value, sizeof(value));
+    return value;
+}
+
+uint32_t MessageReader::ReadCount(size_t min_element_size) {
+    const uint32_t count = ReadUint32();
+    if (count > payload_.size() / min_element_size) {
+        throw std::runtime_error("Truncated shard message");
+    }
+    return count;
+}
+
+double MessageReader::ReadDouble() {
+    double value;
+    ReadBytes(&value, sizeof(value));
+    return value;
+}
+
+std::string_view MessageReader::ReadString() {
+    const uint32_t size = ReadUint32();
+    if (size > payload_.size()) {
+        throw std::runtime_error("Truncated shard message");
+    }
+    const std::string_view value = payload_.substr(0, size);
+    payload_.remove_prefix(size);
+    return value;
+}
+
+DocumentStatus MessageReader::ReadStatus() {
+    const uint8_t status = ReadUint8();
+    if (status > static_cast<uint8_t>(DocumentStatus::REMOVED)) {
+        throw std::runtime_error("Unknown document status in shard message");
+    }
+    return static_cast<DocumentStatus>(status);
+}
+
+std::vector<Document> MessageReader::ReadDocuments() {
+    // Id, relevance and rating
+    const uint32_t count = ReadCount(sizeof(int32_t) + sizeof(double) + sizeof(int32_t));
+    std::vector<Document> documents;
+    documents.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        const int id = ReadInt32();
+        const double relevance = ReadDouble();
+        const int rating = ReadInt32();
+        documents.emplace_back(id, relevance, rating);
+    }
+    return documents;
+}
+
+SearchServer::QueryStatistics MessageReader::ReadStatistics() {
+    SearchServer::QueryStatistics statistics;
+    statistics.document_count = ReadInt32();
+    // Word size and document frequency
+    const uint32_t count = ReadCount(sizeof(uint32_t) + sizeof(int32_t));
+    for (uint32_t i = 0; i < count; ++i) {
+        const std::string_view word = ReadString();
+        statistics.document_freqs.emplace(word, ReadInt32());
+    }
+    return statistics;
+}
+
+void MessageReader::ReadBytes(void* data, size_t size) {
+    if (size > payload_.size()) {
+        throw std::runtime_error("Truncated shard message");
+    }
+    std::memcpy(data, payload_.data(), size);
+    payload_.remove_prefix(size);
+}
+
+void SendMessage(int socket_fd, const std::string& payload) {
+    if (payload.size() > MAX_MESSAGE_SIZE) {
+        throw std::runtime_error("Shard message is too large");
+    }
+    const auto size = static_cast<uint32_t>(payload.size());
+    SendBytes(socket_fd, reinterpret_cast<const char*>(&size), sizeof(size));
+    SendBytes(socket_fd, payload.data(), payload.size());
+}
+
+std::string ReadMessage(int socket_fd) {
+    uint32_t size;
+    ReceiveBytes(socket_fd, reinterpret_cast<char*>(&size), sizeof(size));
+    if (size > MAX_MESSAGE_SIZE) {
+        throw std::runtime_error("Shard message is too large");
+    }
+    std::string payload(size, '\0');
+    ReceiveBytes(socket_fd, payload.data(), size);
+    return payload;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Wire protocol between a shard coordinator and shard processes on the same host.
+// Every message is a 32-bit payload size followed by the payload. A request payload
+// starts with its ShardRequest type, a response payload with its ShardResponse status.
+// Values are stored in the native byte order, so both sides must run on one kind of host
+
+enum class ShardRequest : uint8_t {
+    ADD_DOCUMENT,
+    ADD_DOCUMENTS,
+    REMOVE_DOCUMENT,
+    GET_DOCUMENT_COUNT,
+    GET_QUERY_STATISTICS,
+    FIND_TOP_DOCUMENTS,
+    // A count followed by the ids, removed under one lock
+    REMOVE_DOCUMENTS,
+    // The query and the id. Answered with the status and the matched words
+    MATCH_DOCUMENT,
+};
+
+enum class ShardResponse : uint8_t {
+    OK,
+    // The payload is the message of the std::invalid_argument the shard threw
+    INVALID_ARGUMENT,
+    // The payload is the message of any other exception
+    ERROR,
+    // Answers ADD_DOCUMENTS. The payload is the index of the first invalid document
+    // of the request followed by the message of the std::invalid_argument
+    INVALID_DOCUMENT,
+    // The payload is the message of the std::out_of_range the shard threw
+    OUT_OF_RANGE,
+};
+
+// Appends values to a message payload
+class MessageWriter {
+public:
+    void WriteUint8(uint8_t value);
+    void WriteInt32(int32_t value);
+    void WriteUint32(uint32_t value);
+    void WriteDouble(double value);
+    void WriteString(std::string_view value);
+    void WriteStatus(DocumentStatus status);
+
+    void WriteDocuments(const std::vector<Document>& documents);
+    void WriteStatistics(const SearchServer::QueryStatistics& statistics);
+
+    const std::string& GetPayload() const noexcept {
+        return payload_;
+    }
+
+private:
+    std::string payload_;
+
+    void WriteBytes(const void* data, size_t size);
+};
+
+// Reads values back from a payload. Throws std::runtime_error past its end
+class MessageReader {
+public:
+    explicit MessageReader(std::string_view payload)
+            : payload_(payload) {
+    }
+
+    uint8_t ReadUint8();
+    int32_t ReadInt32();
+    uint32_t ReadUint32();
+    // Reads the number of elements that follow. Throws std::runtime_error when the rest of
+    // the payload can not hold that many elements of at least min_element_size bytes, so that
+    // a malformed count never sizes an allocation
+    uint32_t ReadCount(size_t min_element_size);
+    double ReadDouble();
+    // The view points into the payload
+    std::string_view ReadString();
+    // Throws std::runtime_error for a value that is not a DocumentStatus
+    DocumentStatus ReadStatus();
+
+    std::vector<Document> ReadDocuments();
+    SearchServer::QueryStatistics ReadStatistics();
+
+private:
+    std::string_view payload_;
+
+    void ReadBytes(void* data, size_t size);
+};
+
+// Blocking socket I/O of whole messages. Both throw std::runtime_error when the
+// connection fails, ReadMessage also when the peer closes it
+void SendMessage(int socket_fd, const std::string& payload);
+std::string ReadMessage(int socket_fd);
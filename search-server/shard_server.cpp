@@ -0,0 +1,215 @@
+#include "shard_server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+// Id, text size, status and rating count
+const size_t MIN_DOCUMENT_SIZE = sizeof(int32_t) + sizeof(uint32_t) + sizeof(uint8_t) + sizeof(uint32_t);
+
+std::vector<int> ReadRatings(MessageReader& reader) {
+    std::vector<int> ratings(reader.ReadCount(sizeof(int32_t)));
+    for (int& rating : ratings) {
+        rating = reader.ReadInt32();
+    }
+    return ratings;
+}
+
+} // namespace
+
+ShardServer::ShardServer(SearchServer& search_server, const std::string& socket_path)
+        : search_server_(search_server)
+        , socket_path_(socket_path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("Socket path is too long: " + socket_path);
+    }
+    std::copy(socket_path.begin(), socket_path.end(), address.sun_path);
+
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) {
+        throw std::runtime_error(std::string("Can not create socket: ") + std::strerror(errno));
+    }
+    unlink(socket_path.c_str());
+    if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+        || listen(listen_fd_, SOMAXCONN) != 0) {
+        const std::string error = std::strerror(errno);
+        close(listen_fd_);
+        throw std::runtime_error("Can not listen at " + socket_path + ": " + error);
+    }
+}
+
+ShardServer::~ShardServer() {
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+}
+
+void ShardServer::Run() {
+    while (!is_stopping_) {
+        const int connection_fd = accept(listen_fd_, nullptr, nullptr);
+        if (connection_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            // Stop shuts the listening socket down, which fails the accept
+            break;
+        }
+        std::lock_guard guard(connections_mutex_);
+        if (is_stopping_) {
+            close(connection_fd);
+            break;
+        }
+        connection_fds_.push_back(connection_fd);
+        ++connection_count_;
+        std::thread([this, connection_fd] {
+            ServeConnection(connection_fd);
+        }).detach();
+    }
+
+    std::unique_lock lock(connections_mutex_);
+    for (const int connection_fd : connection_fds_) {
+        shutdown(connection_fd, SHUT_RDWR);
+    }
+    connections_closed_.wait(lock, [this] {
+        return connection_count_ == 0;
+    });
+}
+
+void ShardServer::Stop() {
+    is_stopping_ = true;
+    shutdown(listen_fd_, SHUT_RDWR);
+    std::lock_guard guard(connections_mutex_);
+    for (const int connection_fd : connection_fds_) {
+        shutdown(connection_fd, SHUT_RDWR);
+    }
+}
+
+void ShardServer::ServeConnection(int connection_fd) {
+    try {
+        while (true) {
+            const std::string request = ReadMessage(connection_fd);
+            SendMessage(connection_fd, HandleRequest(request));
+        }
+    } catch (...) {
+        // The coordinator has gone, the server stops, or a message could not be read or
+        // answered, such as a huge frame failing its allocation. The stream is out of step then
+    }
+    // Notified under the lock, so that Run can not return and the server can not be
+    // destroyed before the thread is done with it
+    std::lock_guard guard(connections_mutex_);
+    connection_fds_.erase(std::find(connection_fds_.begin(), connection_fds_.end(), connection_fd));
+    close(connection_fd);
+    --connection_count_;
+    connections_closed_.notify_all();
+}
+
+std::string ShardServer::HandleRequest(std::string_view request) {
+    MessageWriter response;
+    try {
+        MessageReader reader(request);
+        MessageWriter result;
+        switch (static_cast<ShardRequest>(reader.ReadUint8())) {
+            case ShardRequest::ADD_DOCUMENT: {
+                const int document_id = reader.ReadInt32();
+                const std::string_view text = reader.ReadString();
+                const auto status = reader.ReadStatus();
+                const std::vector<int> ratings = ReadRatings(reader);
+                std::unique_lock lock(index_mutex_);
+                search_server_.AddDocument(document_id, text, status, ratings);
+                break;
+            }
+            case ShardRequest::ADD_DOCUMENTS: {
+                std::vector<NewDocument> documents(reader.ReadCount(MIN_DOCUMENT_SIZE));
+                for (NewDocument& document : documents) {
+                    document.id = reader.ReadInt32();
+                    document.text = reader.ReadString();
+                    document.status = reader.ReadStatus();
+                    document.ratings = ReadRatings(reader);
+                }
+                std::unique_lock lock(index_mutex_);
+                try {
+                    search_server_.AddDocuments(std::execution::par, documents);
+                } catch (const std::invalid_argument& e) {
+                    // Looked for only after a failure, so that valid batches are checked once
+                    response.WriteUint8(static_cast<uint8_t>(ShardResponse::INVALID_DOCUMENT));
+                    response.WriteUint32(static_cast<uint32_t>(search_server_.FindFirstInvalidDocument(documents).first));
+                    response.WriteString(e.what());
+                    return response.GetPayload();
+                }
+                break;
+            }
+            case ShardRequest::REMOVE_DOCUMENT: {
+                const int document_id = reader.ReadInt32();
+                std::unique_lock lock(index_mutex_);
+                search_server_.RemoveDocument(document_id);
+                break;
+            }
+            case ShardRequest::REMOVE_DOCUMENTS: {
+                std::vector<int> document_ids(reader.ReadCount(sizeof(int32_t)));
+                for (int& document_id : document_ids) {
+                    document_id = reader.ReadInt32();
+                }
+                std::unique_lock lock(index_mutex_);
+                for (const int document_id : document_ids) {
+                    search_server_.RemoveDocument(document_id);
+                }
+                break;
+            }
+            case ShardRequest::GET_DOCUMENT_COUNT: {
+                std::shared_lock lock(index_mutex_);
+                result.WriteInt32(search_server_.GetDocumentCount());
+                break;
+            }
+            case ShardRequest::GET_QUERY_STATISTICS: {
+                const std::string_view raw_query = reader.ReadString();
+                std::shared_lock lock(index_mutex_);
+                result.WriteStatistics(search_server_.GetQueryStatistics(raw_query));
+                break;
+            }
+            case ShardRequest::FIND_TOP_DOCUMENTS: {
+                const std::string_view raw_query = reader.ReadString();
+                const auto status = reader.ReadStatus();
+                const uint32_t top_k = reader.ReadUint32();
+                const SearchServer::QueryStatistics statistics = reader.ReadStatistics();
+                std::shared_lock lock(index_mutex_);
+                result.WriteDocuments(search_server_.FindTopDocuments(raw_query, statistics, status, top_k));
+                break;
+            }
+            case ShardRequest::MATCH_DOCUMENT: {
+                const std::string_view raw_query = reader.ReadString();
+                const int document_id = reader.ReadInt32();
+                std::shared_lock lock(index_mutex_);
+                const auto [words, status] = search_server_.MatchDocument(raw_query, document_id);
+                result.WriteStatus(status);
+                result.WriteUint32(static_cast<uint32_t>(words.size()));
+                for (const std::string_view word : words) {
+                    result.WriteString(word);
+                }
+                break;
+            }
+            default:
+                throw std::runtime_error("Unknown shard request");
+        }
+        response.WriteUint8(static_cast<uint8_t>(ShardResponse::OK));
+        return response.GetPayload() + result.GetPayload();
+    } catch (const std::invalid_argument& e) {
+        response.WriteUint8(static_cast<uint8_t>(ShardResponse::INVALID_ARGUMENT));
+        response.WriteString(e.what());
+    } catch (const std::out_of_range& e) {
+        response.WriteUint8(static_cast<uint8_t>(ShardResponse::OUT_OF_RANGE));
+        response.WriteString(e.what());
+    } catch (const std::exception& e) {
+        response.WriteUint8(static_cast<uint8_t>(ShardResponse::ERROR));
+        response.WriteString(e.what());
+    }
+    return response.GetPayload();
+}
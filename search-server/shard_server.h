@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+#include "shard_protocol.h"
+
+// Serves a SearchServer to shard coordinators over a Unix domain socket. Every
+// connection has a thread of its own. Queries run concurrently, changes of the
+// index one at a time while no query runs
+class ShardServer {
+public:
+    // Listens at socket_path, replacing a socket file left by an earlier process.
+    // Throws std::runtime_error when the socket can not be set up
+    ShardServer(SearchServer& search_server, const std::string& socket_path);
+    ~ShardServer();
+
+    ShardServer(const ShardServer&) = delete;
+    ShardServer& operator=(const ShardServer&) = delete;
+
+    // Serves connections until Stop is called
+    void Run();
+
+    // Makes Run close all connections and return. Safe to call from any thread
+    void Stop();
+
+private:
+    SearchServer& search_server_;
+    std::string socket_path_;
+    int listen_fd_ = -1;
+    std::atomic<bool> is_stopping_ = false;
+    std::shared_mutex index_mutex_;
+    std::mutex connections_mutex_;
+    std::vector<int> connection_fds_;
+    // Connection threads are detached and counted, so that finished ones leave nothing behind
+    size_t connection_count_ = 0;
+    std::condition_variable connections_closed_;
+
+    void ServeConnection(int connection_fd);
+
+    // Runs the request and returns the response payload
+    std::string HandleRequest(std::string_view request);
+};
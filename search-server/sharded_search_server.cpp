@@ -0,0 +1,266 @@
+#include "sharded_search_server.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace {
+
+// CPUs the process may run on, empty when they can not be found out
+std::vector<int> GetAllowedCpus() {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) != 0) {
+        return {};
+    }
+    std::vector<int> allowed_cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpus)) {
+            allowed_cpus.push_back(cpu);
+        }
+    }
+    return allowed_cpus;
+}
+
+} // namespace
+
+size_t GetDocumentShard(int document_id, size_t shard_count) noexcept {
+    // Fibonacci hashing spreads runs of consecutive ids over all shards
+    const uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) * 0x9e3779b97f4a7c15ULL;
+    return (hash >> 32) % shard_count;
+}
+
+// Runs the tasks it is given one by one on a thread of its own
+class ShardedSearchServer::Worker {
+public:
+    Worker()
+            : thread_([this] { Run(); }) {
+    }
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    ~Worker() {
+        {
+            std::lock_guard guard(mutex_);
+            is_stopping_ = true;
+        }
+        has_tasks_.notify_one();
+        thread_.join();
+    }
+
+    // The future receives the result of the task or the exception it throws
+    template <typename Task>
+    auto Submit(Task task) {
+        using Result = decltype(task());
+        auto packaged_task = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+        auto result = packaged_task->get_future();
+        {
+            std::lock_guard guard(mutex_);
+            tasks_.emplace_back([packaged_task] {
+                (*packaged_task)();
+            });
+        }
+        has_tasks_.notify_one();
+        return result;
+    }
+
+    // Returns false when the system refuses, the worker keeps running wherever it may then
+    bool PinToCpu(int cpu) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(cpu, &cpus);
+        return pthread_setaffinity_np(thread_.native_handle(), sizeof(cpus), &cpus) == 0;
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable has_tasks_;
+    std::deque<std::function<void()>> tasks_;
+    bool is_stopping_ = false;
+    // Started last, when the members it uses are ready
+    std::thread thread_;
+
+    void Run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock(mutex_);
+                has_tasks_.wait(lock, [this] {
+                    return is_stopping_ || !tasks_.empty();
+                });
+                if (tasks_.empty()) {
+                    return;
+                }
+                task = std::move(tasks_.front());
+                tasks_.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+ShardedSearchServer::ShardedSearchServer(size_t shard_count, std::string_view stop_words_text, bool pin_workers) {
+    if (shard_count == 0) {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    shards_.reserve(shard_count);
+    workers_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.emplace_back(stop_words_text);
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    if (!pin_workers) {
+        return;
+    }
+    // Only CPUs of the affinity mask count, so a process confined by taskset or a
+    // cgroup keeps its workers inside. Shards beyond the CPU count share CPUs
+    const std::vector<int> allowed_cpus = GetAllowedCpus();
+    if (allowed_cpus.empty()) {
+        return;
+    }
+    for (size_t i = 0; i < shard_count; ++i) {
+        if (workers_[i]->PinToCpu(allowed_cpus[i % allowed_cpus.size()])) {
+            ++pinned_worker_count_;
+        }
+    }
+}
+
+ShardedSearchServer::~ShardedSearchServer() = default;
+
+void ShardedSearchServer::AddDocument(int document_id, std::string_view document, DocumentStatus status,
+                                      const std::vector<int>& ratings) {
+    const size_t shard = GetDocumentShard(document_id, shards_.size());
+    workers_[shard]->Submit([&] {
+        shards_[shard].AddDocument(document_id, document, status, ratings);
+    }).get();
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<NewDocument>& documents) {
+    std::vector<std::vector<NewDocument>> shard_documents(shards_.size());
+    // Index in the batch of every document of a part
+    std::vector<std::vector<size_t>> batch_indexes(shards_.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const size_t shard = GetDocumentShard(documents[i].id, shards_.size());
+        shard_documents[shard].push_back(documents[i]);
+        batch_indexes[shard].push_back(i);
+    }
+
+    // Every worker finds the first invalid document of its part. Equal ids share a shard,
+    // so the first of all parts is the one SearchServer::AddDocuments reports for the batch
+    std::vector<std::future<std::pair<size_t, std::exception_ptr>>> checks;
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        checks.push_back(workers_[shard]->Submit([this, shard, &shard_documents, &batch_indexes] {
+            auto invalid = shards_[shard].FindFirstInvalidDocument(shard_documents[shard]);
+            invalid.first = invalid.second ? batch_indexes[shard][invalid.first] : std::numeric_limits<size_t>::max();
+            return invalid;
+        }));
+    }
+    std::pair<size_t, std::exception_ptr> first_invalid{std::numeric_limits<size_t>::max(), nullptr};
+    for (auto& check : checks) {
+        auto invalid = check.get();
+        if (invalid.first < first_invalid.first) {
+            first_invalid = std::move(invalid);
+        }
+    }
+    if (first_invalid.second) {
+        std::rethrow_exception(first_invalid.second);
+    }
+
+    std::vector<std::future<void>> additions;
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        additions.push_back(workers_[shard]->Submit([this, shard, &shard_documents] {
+            shards_[shard].AddDocuments(shard_documents[shard]);
+        }));
+    }
+
+    // A shard adds its part completely or not at all, so when one still fails, for
+    // example out of memory, the parts the other shards have added are removed again
+    std::exception_ptr error;
+    std::vector<size_t> added_shards;
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        try {
+            additions[shard].get();
+            added_shards.push_back(shard);
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (!error) {
+        return;
+    }
+    std::vector<std::future<void>> removals;
+    for (const size_t shard : added_shards) {
+        removals.push_back(workers_[shard]->Submit([this, shard, &shard_documents] {
+            for (const NewDocument& document : shard_documents[shard]) {
+                shards_[shard].RemoveDocument(document.id);
+            }
+        }));
+    }
+    for (auto& removal : removals) {
+        removal.get();
+    }
+    std::rethrow_exception(error);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+    const size_t shard = GetDocumentShard(document_id, shards_.size());
+    workers_[shard]->Submit([this, shard, document_id] {
+        shards_[shard].RemoveDocument(document_id);
+    }).get();
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(std::string_view raw_query, DocumentStatus status,
+                                                            size_t top_k) const {
+    // Gathering the statistics parses the query, so an invalid one throws here
+    SearchServer::QueryStatistics statistics = shards_[0].GetQueryStatistics(raw_query);
+    for (size_t shard = 1; shard < shards_.size(); ++shard) {
+        statistics.Merge(shards_[shard].GetQueryStatistics(raw_query));
+    }
+
+    std::vector<std::future<std::vector<Document>>> shard_results;
+    shard_results.reserve(shards_.size());
+    for (size_t shard = 0; shard < shards_.size(); ++shard) {
+        shard_results.push_back(workers_[shard]->Submit([&, shard] {
+            return shards_[shard].FindTopDocuments(raw_query, statistics, status, top_k);
+        }));
+    }
+    // Every shard holds its own best top_k, so the overall best are among them
+    std::vector<Document> documents;
+    for (auto& shard_result : shard_results) {
+        const std::vector<Document> shard_documents = shard_result.get();
+        documents.insert(documents.end(), shard_documents.begin(), shard_documents.end());
+    }
+    const auto top_end = documents.begin() + std::min(top_k, documents.size());
+    std::partial_sort(documents.begin(), top_end, documents.end(), SearchServer::IsMoreRelevant);
+    documents.erase(top_end, documents.end());
+    return documents;
+}
+
+SearchServer::GigaChadMatchDoc ShardedSearchServer::MatchDocument(std::string_view raw_query, int document_id) const {
+    const size_t shard = GetDocumentShard(document_id, shards_.size());
+    return workers_[shard]->Submit([&, shard] {
+        return shards_[shard].MatchDocument(raw_query, document_id);
+    }).get();
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+    int document_count = 0;
+    for (const SearchServer& shard : shards_) {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
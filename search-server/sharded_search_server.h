@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+// Shard that holds the document when the collection is split into shard_count parts
+size_t GetDocumentShard(int document_id, size_t shard_count) noexcept;
+
+// Documents split between shards by a hash of their id. Every shard has a worker
+// thread of its own, which does all the work on the shard. A query runs on all shards at once with IDF computed from the whole
+// collection, so it ranks like a single SearchServer holding all the documents.
+// Like SearchServer, it must not be modified while queries run
+class ShardedSearchServer {
+public:
+    // With pin_workers every worker is pinned to one of the CPUs the process may run on.
+    // That helps on a machine dedicated to the server, and hurts when other work shares
+    // the CPUs, so it is off by default. Pinning is a hint, workers the system refuses
+    // to pin run unpinned
+    ShardedSearchServer(size_t shard_count, std::string_view stop_words_text, bool pin_workers = false);
+    ~ShardedSearchServer();
+
+    ShardedSearchServer(const ShardedSearchServer&) = delete;
+    ShardedSearchServer& operator=(const ShardedSearchServer&) = delete;
+
+    void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+
+    // Every shard adds its part of the batch concurrently. Throws the exception
+    // SearchServer::AddDocuments would throw for the first invalid document and adds nothing then
+    void AddDocuments(const std::vector<NewDocument>& documents);
+
+    void RemoveDocument(int document_id);
+
+    // Best top_k documents of all shards, in the order SearchServer::FindTopDocuments gives
+    std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL,
+                                           size_t top_k = MAX_RESULT_DOCUMENT_COUNT) const;
+
+    SearchServer::GigaChadMatchDoc MatchDocument(std::string_view raw_query, int document_id) const;
+
+    int GetDocumentCount() const;
+
+    size_t GetShardCount() const noexcept {
+        return shards_.size();
+    }
+
+    const SearchServer& GetShard(size_t shard) const {
+        return shards_[shard];
+    }
+
+    // Zero unless pinning was asked for
+    size_t GetPinnedWorkerCount() const noexcept {
+        return pinned_worker_count_;
+    }
+
+private:
+    class Worker;
+
+    std::vector<SearchServer> shards_;
+    // workers_[i] serves shards_[i]
+    std::vector<std::unique_ptr<Worker>> workers_;
+    size_t pinned_worker_count_ = 0;
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// Vector keeping up to InlineCapacity elements inside the object, so short
+// sequences need no allocation. Longer ones move to the heap like std::vector.
+// Meant for small trivially copyable elements such as term ids
+template <typename T, size_t InlineCapacity>
+class SmallVector {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector supports only trivially copyable elements");
+
+    using value_type = T;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() = default;
+
+    SmallVector(const SmallVector& other) {
+        Assign(other);
+    }
+
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other) {
+            size_ = 0;
+            Assign(other);
+        }
+        return *this;
+    }
+
+    SmallVector(SmallVector&& other) noexcept {
+        Take(other);
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            heap_.reset();
+            capacity_ = InlineCapacity;
+            Take(other);
+        }
+        return *this;
+    }
+
+    T* data() noexcept {
+        return heap_ ? heap_.get() : inline_;
+    }
+
+    const T* data() const noexcept {
+        return heap_ ? heap_.get() : inline_;
+    }
+
+    T* begin() noexcept {
+        return data();
+    }
+
+    T* end() noexcept {
+        return data() + size_;
+    }
+
+    const T* begin() const noexcept {
+        return data();
+    }
+
+    const T* end() const noexcept {
+        return data() + size_;
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    size_t capacity() const noexcept {
+        return capacity_;
+    }
+
+    T& operator[](size_t index) noexcept {
+        return data()[index];
+    }
+
+    const T& operator[](size_t index) const noexcept {
+        return data()[index];
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity <= capacity_) {
+            return;
+        }
+        auto heap = std::make_unique<T[]>(capacity);
+        std::copy(begin(), end(), heap.get());
+        heap_ = std::move(heap);
+        capacity_ = capacity;
+    }
+
+    void push_back(const T& value) {
+        if (size_ == capacity_) {
+            // The value may live in the storage being replaced
+            const T copy = value;
+            reserve(capacity_ * 2);
+            data()[size_++] = copy;
+            return;
+        }
+        data()[size_++] = value;
+    }
+
+    // Keeps the storage, so refilling needs no allocation
+    void clear() noexcept {
+        size_ = 0;
+    }
+
+    iterator erase(iterator first, iterator last) {
+        const iterator new_end = std::copy(last, end(), first);
+        size_ = new_end - begin();
+        return first;
+    }
+
+    bool operator==(const SmallVector& other) const {
+        return std::equal(begin(), end(), other.begin(), other.end());
+    }
+
+    bool operator!=(const SmallVector& other) const {
+        return !(*this == other);
+    }
+
+    bool operator<(const SmallVector& other) const {
+        return std::lexicographical_compare(begin(), end(), other.begin(), other.end());
+    }
+
+private:
+    size_t size_ = 0;
+    size_t capacity_ = InlineCapacity;
+    T inline_[InlineCapacity];
+    std::unique_ptr<T[]> heap_;
+
+    void Assign(const SmallVector& other) {
+        reserve(other.size_);
+        std::copy(other.begin(), other.end(), data());
+        size_ = other.size_;
+    }
+
+    // Steals the heap storage of other or copies its inline elements
+    void Take(SmallVector& other) noexcept {
+        if (other.heap_) {
+            heap_ = std::move(other.heap_);
+            capacity_ = other.capacity_;
+        } else {
+            std::copy(other.begin(), other.end(), inline_);
+        }
+        size_ = other.size_;
+        other.size_ = 0;
+        other.capacity_ = InlineCapacity;
+    }
+};
@@ -0,0 +1,128 @@
+#include "snapshot_file.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char MAGIC[8] = {'S', 'R', 'C', 'H', 'S', 'N', 'A', 'P'};
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+// Sections start at cache line boundaries
+const size_t SECTION_ALIGNMENT = 64;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t section_table_offset;
+    uint64_t section_count;
+};
+
+} // namespace
+
+SnapshotWriter::SnapshotWriter(const std::string& path, uint32_t version)
+        : out_(path, std::ios::binary | std::ios::trunc)
+        , version_(version) {
+    if (!out_) {
+        throw std::runtime_error("Can not create snapshot file " + path);
+    }
+    // Rewritten by Finish once the section table is known
+    const FileHeader header{};
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+void SnapshotWriter::Finish() {
+    Align();
+    FileHeader header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = version_;
+    header.byte_order_mark = BYTE_ORDER_MARK;
+    header.section_table_offset = static_cast<uint64_t>(out_.tellp());
+    header.section_count = sections_.size();
+    out_.write(reinterpret_cast<const char*>(sections_.data()), sections_.size() * sizeof(Section));
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out_.flush();
+    if (!out_) {
+        throw std::runtime_error("Failed to write snapshot file");
+    }
+}
+
+void SnapshotWriter::WriteSection(uint32_t section_id, const void* data, size_t element_size, size_t count) {
+    Align();
+    const Section section{section_id, static_cast<uint32_t>(element_size),
+                          static_cast<uint64_t>(out_.tellp()), element_size * count};
+    out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(section.size));
+    sections_.push_back(section);
+}
+
+void SnapshotWriter::Align() {
+    const auto position = static_cast<size_t>(out_.tellp());
+    const size_t padding = (SECTION_ALIGNMENT - position % SECTION_ALIGNMENT) % SECTION_ALIGNMENT;
+    const char zeros[SECTION_ALIGNMENT] = {};
+    out_.write(zeros, static_cast<std::streamsize>(padding));
+}
+
+MappedSnapshot::MappedSnapshot(const std::string& path, uint32_t version) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Can not open snapshot file " + path);
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(FileHeader)) {
+        close(fd);
+        throw std::runtime_error("Not a snapshot file: " + path);
+    }
+    size_ = static_cast<size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Can not map snapshot file " + path);
+    }
+    data_ = static_cast<const char*>(data);
+
+    const auto* header = reinterpret_cast<const FileHeader*>(data_);
+    std::string error;
+    if (std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->byte_order_mark != BYTE_ORDER_MARK) {
+        error = "Not a snapshot file: " + path;
+    } else if (header->version != version) {
+        error = "Unsupported snapshot version " + std::to_string(header->version);
+    } else if (header->section_table_offset > size_
+               || header->section_count > (size_ - header->section_table_offset) / sizeof(SnapshotWriter::Section)) {
+        error = "Truncated snapshot file: " + path;
+    } else if (header->section_table_offset % alignof(SnapshotWriter::Section) != 0) {
+        error = "Corrupted snapshot file: " + path;
+    }
+    if (!error.empty()) {
+        munmap(data, size_);
+        throw std::runtime_error(error);
+    }
+}
+
+MappedSnapshot::~MappedSnapshot() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+std::pair<const void*, size_t> MappedSnapshot::FindSection(uint32_t section_id, size_t element_size,
+                                                           size_t alignment) const {
+    const auto* header = reinterpret_cast<const FileHeader*>(data_);
+    const auto* sections = reinterpret_cast<const SnapshotWriter::Section*>(data_ + header->section_table_offset);
+    for (uint64_t i = 0; i < header->section_count; ++i) {
+        const SnapshotWriter::Section& section = sections[i];
+        if (section.id != section_id) {
+            continue;
+        }
+        if (section.element_size != element_size || section.offset % alignment != 0
+            || section.offset > size_ || section.size > size_ - section.offset) {
+            break;
+        }
+        return {data_ + section.offset, section.size / element_size};
+    }
+    throw std::runtime_error("Snapshot section " + std::to_string(section_id) + " is missing or malformed");
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Binary file of numbered sections, each an array of trivially copyable values.
+// The format version belongs to the caller: a file is only opened with the
+// version it was written with. Values are stored in the native byte order and
+// layout, so a snapshot is read on the kind of host that wrote it
+
+// Contiguous array inside a mapped snapshot
+template <typename T>
+class SnapshotArray {
+public:
+    SnapshotArray() = default;
+
+    SnapshotArray(const T* data, size_t size)
+            : data_(data)
+            , size_(size) {
+    }
+
+    const T& operator[](size_t index) const noexcept {
+        return data_[index];
+    }
+
+    const T* data() const noexcept {
+        return data_;
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    const T* begin() const noexcept {
+        return data_;
+    }
+
+    const T* end() const noexcept {
+        return data_ + size_;
+    }
+
+private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+class SnapshotWriter {
+public:
+    // Throws std::runtime_error when the file can not be created
+    SnapshotWriter(const std::string& path, uint32_t version);
+
+    template <typename T>
+    void WriteSection(uint32_t section_id, const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteSection(section_id, values.data(), sizeof(T), values.size());
+    }
+
+    // Writes the section table. Throws std::runtime_error when any write failed
+    void Finish();
+
+private:
+    friend class MappedSnapshot;
+
+    struct Section {
+        uint32_t id;
+        uint32_t element_size;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    std::ofstream out_;
+    uint32_t version_;
+    std::vector<Section> sections_;
+
+    void WriteSection(uint32_t section_id, const void* data, size_t element_size, size_t count);
+
+    void Align();
+};
+
+// Snapshot mapped into memory read-only. Sections are used in place, pages are
+// loaded on first access and shared by every process that maps the same file
+class MappedSnapshot {
+public:
+    // Throws std::runtime_error when the file can not be mapped or was written
+    // with another format or version
+    MappedSnapshot(const std::string& path, uint32_t version);
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+    ~MappedSnapshot();
+
+    // Throws std::runtime_error when the section is missing or holds other values
+    template <typename T>
+    SnapshotArray<T> GetSection(uint32_t section_id) const {
+        static_assert(std::is_trivially_copyable_v<T>);
+        const auto [data, count] = FindSection(section_id, sizeof(T), alignof(T));
+        return {static_cast<const T*>(data), count};
+    }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+
+    std::pair<const void*, size_t> FindSection(uint32_t section_id, size_t element_size, size_t alignment) const;
+};
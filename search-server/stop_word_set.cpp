@@ -0,0 +1,34 @@
+#include "stop_word_set.h"
+
+StopWordSet::StopWordSet(const TransparentStringSet& words) {
+    size_t slot_count = 1;
+    while (slot_count < 2 * words.size()) {
+        slot_count *= 2;
+    }
+    slots_.resize(slot_count);
+    word_offsets_.push_back(0);
+    for (const std::string& word : words) {
+        if (word.empty()) {
+            continue;
+        }
+        const auto offset = static_cast<uint32_t>(text_.size());
+        text_ += word;
+        word_offsets_.push_back(static_cast<uint32_t>(text_.size()));
+
+        const uint64_t hash = std::hash<std::string_view>{}(word);
+        size_t slot = hash & (slot_count - 1);
+        while (slots_[slot].size != 0) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+        slots_[slot] = {hash, offset, static_cast<uint32_t>(word.size())};
+        length_mask_ |= GetLengthBit(word.size());
+    }
+}
+
+std::vector<std::string_view> StopWordSet::GetWords() const {
+    std::vector<std::string_view> words;
+    for (size_t i = 0; i + 1 < word_offsets_.size(); ++i) {
+        words.push_back(std::string_view(text_).substr(word_offsets_[i], word_offsets_[i + 1] - word_offsets_[i]));
+    }
+    return words;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "string_processing.h"
+
+// Immutable set of stop words in one flat open-addressed table. Slots keep the
+// hash and the place of their word in a shared text buffer, so a lookup compares
+// hashes in one array and reads the text of a matching word only. Words of
+// lengths no stop word has are rejected before hashing
+class StopWordSet {
+public:
+    StopWordSet() = default;
+
+    // Empty words are not stored
+    explicit StopWordSet(const TransparentStringSet& words);
+
+    bool Contains(std::string_view word) const noexcept {
+        if ((length_mask_ & GetLengthBit(word.size())) == 0) {
+            return false;
+        }
+        const uint64_t hash = std::hash<std::string_view>{}(word);
+        const size_t slot_mask = slots_.size() - 1;
+        // The table is at most half full, so the probe meets a free slot
+        for (size_t slot = hash & slot_mask;; slot = (slot + 1) & slot_mask) {
+            const Slot& entry = slots_[slot];
+            if (entry.size == 0) {
+                return false;
+            }
+            if (entry.hash == hash && entry.size == word.size()
+                && std::string_view(text_).substr(entry.offset, entry.size) == word) {
+                return true;
+            }
+        }
+    }
+
+    size_t size() const noexcept {
+        return word_offsets_.empty() ? 0 : word_offsets_.size() - 1;
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // In alphabetical order, valid while the set lives
+    std::vector<std::string_view> GetWords() const;
+
+private:
+    // A free slot has zero size, no stored word is empty
+    struct Slot {
+        uint64_t hash = 0;
+        uint32_t offset = 0;
+        uint32_t size = 0;
+    };
+
+    // Words back to back in alphabetical order
+    std::string text_;
+    std::vector<uint32_t> word_offsets_;
+    std::vector<Slot> slots_;
+    // Bit n is set when some word has n characters, longer words share the last bit
+    uint64_t length_mask_ = 0;
+
+    static uint64_t GetLengthBit(size_t length) noexcept {
+        return uint64_t{1} << std::min<size_t>(length, 63);
+    }
+};
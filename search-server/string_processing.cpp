@@ -1,17 +1,118 @@
 // в качестве заготовки кода используйте последнюю версию своей поисковой системы
 #include "string_processing.h"
 
-std::vector<std::string_view> SplitIntoWords(std::string_view str) {
-    std::vector<std::string_view> result;
-    while (true) {
-        const auto space = str.find(' ');
-        result.push_back(str.substr(0, space));
-        if (space == str.npos) {
-            break;
-        }
-        else {
-            str.remove_prefix(space + 1);
+#ifdef __SSE2__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+struct SplitState {
+    // First byte not scanned yet
+    size_t position = 0;
+    size_t word_begin = 0;
+    bool has_control_character = false;
+};
+
+bool IsControlCharacter(char c) {
+    return static_cast<unsigned char>(c) < ' ';
+}
+
+#ifdef __SSE2__
+
+// Ends a word at every space marked in the mask of the block starting at block_begin
+void EmitWords(std::string_view text, size_t block_begin, uint32_t space_mask, SplitState& state,
+               std::vector<std::string_view>& words) {
+    while (space_mask != 0) {
+        const size_t space = block_begin + __builtin_ctz(space_mask);
+        words.push_back(text.substr(state.word_begin, space - state.word_begin));
+        state.word_begin = space + 1;
+        space_mask &= space_mask - 1;
+    }
+}
+
+// Scans whole 16-byte blocks. Unsigned bytes below 32 are the ones
+// left unchanged by the minimum with 31
+void SplitBlocksSse2(std::string_view text, SplitState& state, std::vector<std::string_view>& words) {
+    const __m128i spaces = _mm_set1_epi8(' ');
+    const __m128i last_control = _mm_set1_epi8(' ' - 1);
+    __m128i controls = _mm_setzero_si128();
+    for (; state.position + 16 <= text.size(); state.position += 16) {
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text.data() + state.position));
+        controls = _mm_or_si128(controls, _mm_cmpeq_epi8(_mm_min_epu8(bytes, last_control), bytes));
+        const auto space_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, spaces)));
+        EmitWords(text, state.position, space_mask, state, words);
+    }
+    state.has_control_character |= _mm_movemask_epi8(controls) != 0;
+}
+
+#ifdef __GNUC__
+#define SPLIT_WITH_AVX2
+
+__attribute__((target("avx2")))
+void SplitBlocksAvx2(std::string_view text, SplitState& state, std::vector<std::string_view>& words) {
+    const __m256i spaces = _mm256_set1_epi8(' ');
+    const __m256i last_control = _mm256_set1_epi8(' ' - 1);
+    __m256i controls = _mm256_setzero_si256();
+    for (; state.position + 32 <= text.size(); state.position += 32) {
+        const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text.data() + state.position));
+        controls = _mm256_or_si256(controls, _mm256_cmpeq_epi8(_mm256_min_epu8(bytes, last_control), bytes));
+        const auto space_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, spaces)));
+        EmitWords(text, state.position, space_mask, state, words);
+    }
+    state.has_control_character |= _mm256_movemask_epi8(controls) != 0;
+}
+#endif
+
+#endif
+
+// Scans the bytes the vector code has left
+void SplitTail(std::string_view text, SplitState& state, std::vector<std::string_view>& words) {
+    for (; state.position < text.size(); ++state.position) {
+        const char c = text[state.position];
+        if (c == ' ') {
+            words.push_back(text.substr(state.word_begin, state.position - state.word_begin));
+            state.word_begin = state.position + 1;
+        } else if (IsControlCharacter(c)) {
+            state.has_control_character = true;
         }
     }
+}
+
+using SplitBlocksFunction = void (*)(std::string_view, SplitState&, std::vector<std::string_view>&);
+
+SplitBlocksFunction ChooseSplitBlocks() {
+#ifdef SPLIT_WITH_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        return SplitBlocksAvx2;
+    }
+#endif
+#ifdef __SSE2__
+    return SplitBlocksSse2;
+#else
+    return SplitTail;
+#endif
+}
+
+// Chosen once for the processor the program runs on
+SplitBlocksFunction GetSplitBlocks() {
+    static const SplitBlocksFunction split_blocks = ChooseSplitBlocks();
+    return split_blocks;
+}
+
+} // namespace
+
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view>& words) {
+    words.clear();
+    SplitState state;
+    GetSplitBlocks()(text, state, words);
+    SplitTail(text, state, words);
+    words.push_back(text.substr(state.word_begin));
+    return !state.has_control_character;
+}
+
+std::vector<std::string_view> SplitIntoWords(std::string_view str) {
+    std::vector<std::string_view> result;
+    SplitIntoWords(str, result);
     return result;
 }
@@ -8,6 +8,12 @@
 
 std::vector<std::string_view> SplitIntoWords(std::string_view);
 
+// Splits the text at every space like SplitIntoWords, but into the buffer given, whose
+// contents are replaced and whose capacity is reused. Returns false when the text holds
+// a control character, which no valid word may contain. Scans with SSE2 or AVX2,
+// whichever the processor supports
+bool SplitIntoWords(std::string_view text, std::vector<std::string_view>& words);
+
 using TransparentStringSet = std::set<std::string, std::less<>>;
 
 template <typename StringContainer>
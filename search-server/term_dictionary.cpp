@@ -0,0 +1,32 @@
+#include "term_dictionary.h"
+
+TermDictionary::TermDictionary(const TermDictionary& other) {
+    words_.reserve(other.words_.size());
+    word_to_term_.reserve(other.word_to_term_.size());
+    for (const std::string_view word : other.words_) {
+        Intern(word);
+    }
+}
+
+TermDictionary& TermDictionary::operator=(const TermDictionary& other) {
+    if (this != &other) {
+        *this = TermDictionary(other);
+    }
+    return *this;
+}
+
+TermId TermDictionary::Intern(std::string_view word) {
+    const auto it = word_to_term_.find(word);
+    if (it != word_to_term_.end()) {
+        return it->second;
+    }
+    const TermId term = static_cast<TermId>(words_.size());
+    const std::string_view stored_word = words_.emplace_back(word_text_.Store(word));
+    word_to_term_.emplace(stored_word, term);
+    return term;
+}
+
+TermId TermDictionary::Find(std::string_view word) const {
+    const auto it = word_to_term_.find(word);
+    return it == word_to_term_.end() ? NO_TERM : it->second;
+}
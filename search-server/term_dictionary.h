@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "text_arena.h"
+
+using TermId = uint32_t;
+
+// Interns words into dense integer ids. The dictionary owns copies of the words,
+// so the views it hands out stay valid when documents are removed
+class TermDictionary {
+public:
+    static constexpr TermId NO_TERM = std::numeric_limits<TermId>::max();
+
+    TermDictionary() = default;
+    // The copy stores the words again, so that its views do not point into the other dictionary
+    TermDictionary(const TermDictionary& other);
+    TermDictionary(TermDictionary&& other) = default;
+    TermDictionary& operator=(const TermDictionary& other);
+    TermDictionary& operator=(TermDictionary&& other) = default;
+
+    // Returns the id of the word, registering it when it is new
+    TermId Intern(std::string_view word);
+
+    // Returns NO_TERM for unknown words
+    TermId Find(std::string_view word) const;
+
+    std::string_view GetWord(TermId term) const {
+        return words_[term];
+    }
+
+    size_t size() const noexcept {
+        return words_.size();
+    }
+
+private:
+    TextArena word_text_;
+    std::vector<std::string_view> words_;
+    std::unordered_map<std::string_view, TermId> word_to_term_;
+};
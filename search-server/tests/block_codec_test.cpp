@@ -0,0 +1,79 @@
+#include "block_codec.h"
+
+#include "test_framework.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// Random values of exactly the given bit width, the widest one set in some value
+vector<uint32_t> GenerateValues(mt19937& generator, uint8_t bit_width) {
+    vector<uint32_t> values(BLOCK_SIZE, 0);
+    if (bit_width == 0) {
+        return values;
+    }
+    const uint32_t mask = bit_width == 32 ? ~0u : (1u << bit_width) - 1;
+    for (uint32_t& value : values) {
+        value = generator() & mask;
+    }
+    values[generator() % BLOCK_SIZE] |= 1u << (bit_width - 1);
+    return values;
+}
+
+void TestRoundTripOfEveryBitWidth() {
+    mt19937 generator(5);
+    const uint32_t guard = 0xdeadbeef;
+    for (int bit_width = 0; bit_width <= 32; ++bit_width) {
+        for (int round = 0; round < 10; ++round) {
+            const vector<uint32_t> values = GenerateValues(generator, static_cast<uint8_t>(bit_width));
+            ASSERT_EQUAL(ComputeBitWidth(values.data()), bit_width);
+
+            // One guard word past the packed block must stay untouched
+            const size_t packed_word_count = GetPackedWordCount(static_cast<uint8_t>(bit_width));
+            vector<uint32_t> packed(packed_word_count + 1, guard);
+            PackBlock(values.data(), static_cast<uint8_t>(bit_width), packed.data());
+            ASSERT_EQUAL(packed.back(), guard);
+
+            alignas(16) uint32_t unpacked[BLOCK_SIZE];
+            fill(begin(unpacked), end(unpacked), guard);
+            UnpackBlock(packed.data(), static_cast<uint8_t>(bit_width), unpacked);
+            ASSERT(equal(values.begin(), values.end(), begin(unpacked)));
+        }
+    }
+}
+
+void TestExtremeValues() {
+    for (const uint32_t value : {0u, 1u, 0x7fffffffu, 0x80000000u, 0xffffffffu}) {
+        const vector<uint32_t> values(BLOCK_SIZE, value);
+        const uint8_t bit_width = ComputeBitWidth(values.data());
+        vector<uint32_t> packed(GetPackedWordCount(bit_width));
+        PackBlock(values.data(), bit_width, packed.data());
+        alignas(16) uint32_t unpacked[BLOCK_SIZE];
+        UnpackBlock(packed.data(), bit_width, unpacked);
+        ASSERT(equal(values.begin(), values.end(), begin(unpacked)));
+    }
+}
+
+void TestRestoreFromDeltas() {
+    mt19937 generator(9);
+    alignas(16) uint32_t values[BLOCK_SIZE];
+    for (const uint32_t base : {0u, 1u, 1000000u}) {
+        vector<uint32_t> expected(BLOCK_SIZE);
+        uint32_t sum = base;
+        for (size_t i = 0; i < BLOCK_SIZE; ++i) {
+            values[i] = generator() % 1000;
+            sum += values[i];
+            expected[i] = sum;
+        }
+        RestoreFromDeltas(values, base);
+        ASSERT(equal(expected.begin(), expected.end(), begin(values)));
+    }
+}
+
+int main() {
+    RUN_TEST(TestRoundTripOfEveryBitWidth);
+    RUN_TEST(TestExtremeValues);
+    RUN_TEST(TestRestoreFromDeltas);
+}
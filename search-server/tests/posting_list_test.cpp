@@ -0,0 +1,228 @@
+#include "posting_list.h"
+
+#include "test_framework.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+using Posting = PostingList::Posting;
+
+// Lengths around the block boundaries, sealed blocks only, with a partial tail and without
+const vector<size_t> LENGTHS = {0, 1, 2, 127, 128, 129, 255, 256, 257, 383, 384, 1000, 1024};
+
+// Ascending ordinals, with gaps from one to max_gap. Frequencies are multiples
+// of 1/8, so that the single precision ones of sealed blocks are exact
+vector<Posting> GeneratePostings(mt19937& generator, size_t length, uint32_t max_gap) {
+    vector<Posting> postings;
+    DocumentOrdinal ordinal = generator() % 10;
+    for (size_t i = 0; i < length; ++i) {
+        postings.push_back({ordinal, static_cast<double>(generator() % 64 + 1) / 8});
+        ordinal += 1 + generator() % max_gap;
+    }
+    return postings;
+}
+
+PostingList MakeList(const vector<Posting>& postings, PostingList::Format format) {
+    PostingList list(format);
+    for (const Posting& posting : postings) {
+        list.Add(posting.ordinal, posting.term_freq);
+    }
+    return list;
+}
+
+vector<Posting> GetPostings(const PostingList& list) {
+    vector<Posting> postings;
+    list.ForEach([&postings](DocumentOrdinal ordinal, double term_freq) {
+        postings.push_back({ordinal, term_freq});
+    });
+    return postings;
+}
+
+vector<Posting> ReadWithCursor(const PostingListView& view) {
+    vector<Posting> postings;
+    for (PostingListView::Cursor cursor(view); !cursor.IsEnd(); cursor.Next()) {
+        postings.push_back({cursor.GetOrdinal(), cursor.GetTermFreq()});
+    }
+    return postings;
+}
+
+bool AreEqual(const vector<Posting>& lhs, const vector<Posting>& rhs) {
+    return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Posting& lhs, const Posting& rhs) {
+        return lhs.ordinal == rhs.ordinal && lhs.term_freq == rhs.term_freq;
+    });
+}
+
+// Gaps from dense ones of a single bit up to ones that need 20 bits
+const vector<uint32_t> MAX_GAPS = {1, 3, 100, 1 << 20};
+
+void TestFormatsHoldSamePostings() {
+    mt19937 generator(1);
+    for (const size_t length : LENGTHS) {
+        for (const uint32_t max_gap : MAX_GAPS) {
+            const vector<Posting> postings = GeneratePostings(generator, length, max_gap);
+            for (const auto format : {PostingList::Format::PLAIN, PostingList::Format::COMPRESSED}) {
+                const PostingList list = MakeList(postings, format);
+                ASSERT_EQUAL(list.size(), length);
+                ASSERT_EQUAL(list.GetDocumentFreq(), length);
+                ASSERT_EQUAL(list.View().GetBlockCount(), (length + BLOCK_SIZE - 1) / BLOCK_SIZE);
+                ASSERT(AreEqual(GetPostings(list), postings));
+                ASSERT(AreEqual(ReadWithCursor(list.View()), postings));
+                for (const Posting& posting : postings) {
+                    ASSERT(list.Contains(posting.ordinal));
+                    ASSERT(posting.term_freq <= list.View().GetMaxTermFreq());
+                }
+                if (!postings.empty()) {
+                    ASSERT(!list.Contains(postings.back().ordinal + 1));
+                }
+            }
+        }
+    }
+}
+
+void TestSetFormatRoundTrip() {
+    mt19937 generator(2);
+    for (const size_t length : LENGTHS) {
+        const vector<Posting> postings = GeneratePostings(generator, length, 1000);
+        PostingList list = MakeList(postings, PostingList::Format::PLAIN);
+        list.SetFormat(PostingList::Format::COMPRESSED);
+        ASSERT(list.GetFormat() == PostingList::Format::COMPRESSED);
+        ASSERT(AreEqual(GetPostings(list), postings));
+        list.SetFormat(PostingList::Format::PLAIN);
+        ASSERT(AreEqual(GetPostings(list), postings));
+    }
+}
+
+void TestOutOfOrderAdd() {
+    mt19937 generator(3);
+    vector<Posting> postings = GeneratePostings(generator, 300, 5);
+    vector<Posting> shuffled = postings;
+    shuffle(shuffled.begin(), shuffled.end(), generator);
+    for (const auto format : {PostingList::Format::PLAIN, PostingList::Format::COMPRESSED}) {
+        ASSERT(AreEqual(GetPostings(MakeList(shuffled, format)), postings));
+    }
+}
+
+// Cursors of both formats stop at the same postings, which are the ones lower_bound finds
+void TestSkipToMatchesBetweenFormats() {
+    mt19937 generator(4);
+    for (const size_t length : LENGTHS) {
+        for (const uint32_t max_gap : MAX_GAPS) {
+            const vector<Posting> postings = GeneratePostings(generator, length, max_gap);
+            const PostingList plain = MakeList(postings, PostingList::Format::PLAIN);
+            const PostingList compressed = MakeList(postings, PostingList::Format::COMPRESSED);
+            const DocumentOrdinal last_ordinal = postings.empty() ? 0 : postings.back().ordinal;
+            // From steps that land on most postings to ones that skip many blocks
+            for (const uint32_t max_step : {max_gap / 4 + 1, max_gap, 50 * max_gap, 1000 * max_gap}) {
+                PostingListView::Cursor plain_cursor(plain.View());
+                PostingListView::Cursor compressed_cursor(compressed.View());
+                DocumentOrdinal target = 0;
+                while (true) {
+                    plain_cursor.SkipTo(target);
+                    compressed_cursor.SkipTo(target);
+                    const auto expected = lower_bound(postings.begin(), postings.end(), target,
+                                                      [](const Posting& posting, DocumentOrdinal ordinal) {
+                                                          return posting.ordinal < ordinal;
+                                                      });
+                    if (expected == postings.end()) {
+                        ASSERT(plain_cursor.IsEnd());
+                        ASSERT(compressed_cursor.IsEnd());
+                        ASSERT_EQUAL(compressed_cursor.GetOrdinal(), PostingListView::Cursor::END);
+                        break;
+                    }
+                    ASSERT_EQUAL(plain_cursor.GetOrdinal(), expected->ordinal);
+                    ASSERT_EQUAL(compressed_cursor.GetOrdinal(), expected->ordinal);
+                    ASSERT_EQUAL(plain_cursor.GetTermFreq(), expected->term_freq);
+                    ASSERT_EQUAL(compressed_cursor.GetTermFreq(), expected->term_freq);
+                    // Bounds of the block the cursor is in cover its posting
+                    ASSERT(compressed_cursor.GetBlockLastOrdinal() >= expected->ordinal);
+                    ASSERT(compressed_cursor.GetBlockMaxTermFreq() >= expected->term_freq);
+                    ASSERT_EQUAL(plain_cursor.GetBlockLastOrdinal(), compressed_cursor.GetBlockLastOrdinal());
+
+                    // Skipping backwards or to the current posting stays put
+                    compressed_cursor.SkipTo(target / 2);
+                    compressed_cursor.SkipTo(expected->ordinal);
+                    ASSERT_EQUAL(compressed_cursor.GetOrdinal(), expected->ordinal);
+                    if (target > last_ordinal) {
+                        break;
+                    }
+                    target += 1 + generator() % max_step;
+                }
+            }
+        }
+    }
+}
+
+void TestShallowSkipTo() {
+    mt19937 generator(6);
+    for (const size_t length : {size_t(1), size_t(128), size_t(1000), size_t(1024)}) {
+        const vector<Posting> postings = GeneratePostings(generator, length, 10);
+        for (const auto format : {PostingList::Format::PLAIN, PostingList::Format::COMPRESSED}) {
+            const PostingList list = MakeList(postings, format);
+            PostingListView::Cursor cursor(list.View());
+            for (DocumentOrdinal target = 0; target <= postings.back().ordinal; target += 1 + generator() % 200) {
+                ASSERT(cursor.ShallowSkipTo(target));
+                // The block is the first one whose last posting is not before the target
+                const size_t index = lower_bound(postings.begin(), postings.end(), target,
+                                                 [](const Posting& posting, DocumentOrdinal ordinal) {
+                                                     return posting.ordinal < ordinal;
+                                                 }) - postings.begin();
+                const size_t block_begin = index / BLOCK_SIZE * BLOCK_SIZE;
+                const size_t block_end = min(postings.size(), block_begin + BLOCK_SIZE);
+                ASSERT_EQUAL(cursor.GetBlockLastOrdinal(), postings[block_end - 1].ordinal);
+                double block_max_term_freq = 0.0;
+                for (size_t i = block_begin; i < block_end; ++i) {
+                    block_max_term_freq = max(block_max_term_freq, postings[i].term_freq);
+                }
+                ASSERT_EQUAL(cursor.GetBlockMaxTermFreq(), block_max_term_freq);
+            }
+            ASSERT(!cursor.ShallowSkipTo(postings.back().ordinal + 1));
+        }
+    }
+}
+
+void TestCompact() {
+    mt19937 generator(7);
+    for (const size_t length : LENGTHS) {
+        vector<Posting> postings = GeneratePostings(generator, length, 3);
+        const DocumentOrdinal ordinal_count = postings.empty() ? 0 : postings.back().ordinal + 1;
+        // Every third ordinal is removed, the rest are numbered densely
+        vector<DocumentOrdinal> new_ordinals(ordinal_count);
+        DocumentOrdinal next_ordinal = 0;
+        for (DocumentOrdinal ordinal = 0; ordinal < ordinal_count; ++ordinal) {
+            new_ordinals[ordinal] = ordinal % 3 == 0 ? REMOVED_ORDINAL : next_ordinal++;
+        }
+        vector<Posting> expected;
+        size_t removed_count = 0;
+        for (const Posting& posting : postings) {
+            if (new_ordinals[posting.ordinal] == REMOVED_ORDINAL) {
+                ++removed_count;
+            } else {
+                expected.push_back({new_ordinals[posting.ordinal], posting.term_freq});
+            }
+        }
+        for (const auto format : {PostingList::Format::PLAIN, PostingList::Format::COMPRESSED}) {
+            PostingList list = MakeList(postings, format);
+            for (size_t i = 0; i < removed_count; ++i) {
+                list.MarkRemoved();
+            }
+            ASSERT_EQUAL(list.GetDocumentFreq(), expected.size());
+            list.Compact(new_ordinals);
+            ASSERT_EQUAL(list.size(), expected.size());
+            ASSERT_EQUAL(list.GetDocumentFreq(), expected.size());
+            ASSERT(AreEqual(GetPostings(list), expected));
+            ASSERT(AreEqual(ReadWithCursor(list.View()), expected));
+        }
+    }
+}
+
+int main() {
+    RUN_TEST(TestFormatsHoldSamePostings);
+    RUN_TEST(TestSetFormatRoundTrip);
+    RUN_TEST(TestOutOfOrderAdd);
+    RUN_TEST(TestSkipToMatchesBetweenFormats);
+    RUN_TEST(TestShallowSkipTo);
+    RUN_TEST(TestCompact);
+}
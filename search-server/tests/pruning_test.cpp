@@ -0,0 +1,144 @@
+#include "search_server.h"
+
+#include "test_framework.h"
+
+#include <algorithm>
+#include <cmath>
+#include <execution>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Sequential FindTopDocuments prunes queries of up to PRUNING_MAX_QUERY_WORDS plus words,
+// the parallel one always scores every matching document. Both must rank alike
+
+const int DOCUMENT_COUNT = 3000;
+const int DICTIONARY_SIZE = 200;
+
+string GetWord(int index) {
+    return "w"s + to_string(index);
+}
+
+// Skewed word frequencies, so that the lists of common words span many blocks
+// and their bounds differ from those of rare words
+int GenerateWordIndex(mt19937& generator) {
+    const double x = uniform_real_distribution<>(0, 1)(generator);
+    return static_cast<int>(DICTIONARY_SIZE * x * x * x);
+}
+
+SearchServer MakeServer(mt19937& generator, PostingList::Format format) {
+    SearchServer search_server("w3 w7"s);
+    search_server.SetPostingFormat(format);
+    string previous_text;
+    for (int id = 0; id < DOCUMENT_COUNT; ++id) {
+        string text;
+        // Some documents repeat the previous one, which gives equal relevances
+        if (id % 10 == 5) {
+            text = previous_text;
+        } else {
+            const int word_count = uniform_int_distribution(1, 30)(generator);
+            for (int i = 0; i < word_count; ++i) {
+                text += GetWord(GenerateWordIndex(generator)) + " "s;
+            }
+            text.pop_back();
+        }
+        const auto status = static_cast<DocumentStatus>(id % 7 == 0 ? 2 : 0);
+        // Few ratings, so that equal relevances often come with equal ratings too
+        search_server.AddDocument(id, text, status, {uniform_int_distribution(0, 3)(generator)});
+        previous_text = text;
+    }
+    return search_server;
+}
+
+string GenerateQuery(mt19937& generator, int plus_word_count, int minus_word_count) {
+    set<int> words;
+    while (static_cast<int>(words.size()) < plus_word_count + minus_word_count) {
+        const int word = GenerateWordIndex(generator);
+        // Stop words would not count towards the pruning limit
+        if (word != 3 && word != 7) {
+            words.insert(word);
+        }
+    }
+    vector<int> shuffled(words.begin(), words.end());
+    shuffle(shuffled.begin(), shuffled.end(), generator);
+    string query;
+    for (int i = 0; i < static_cast<int>(shuffled.size()); ++i) {
+        query += (i < minus_word_count ? "-"s : ""s) + GetWord(shuffled[i]) + " "s;
+    }
+    query.pop_back();
+    return query;
+}
+
+// Documents equal in relevance and rating may come in any order and either of them
+// may take the last place. So every pruned document has to be scored like in the full
+// answer, and place by place the two answers have to rank alike
+void CheckSameRanking(const vector<Document>& pruned, const vector<Document>& all, size_t top_k) {
+    map<int, pair<double, int>> scores;
+    for (const Document& document : all) {
+        scores[document.id] = {document.relevance, document.rating};
+    }
+    ASSERT_EQUAL(pruned.size(), min(top_k, all.size()));
+    set<int> ids;
+    for (size_t i = 0; i < pruned.size(); ++i) {
+        ASSERT(ids.insert(pruned[i].id).second);
+        ASSERT(scores.count(pruned[i].id) == 1);
+        const auto [relevance, rating] = scores.at(pruned[i].id);
+        ASSERT(abs(pruned[i].relevance - relevance) < PRECISION);
+        ASSERT_EQUAL(pruned[i].rating, rating);
+        ASSERT(abs(pruned[i].relevance - all[i].relevance) < PRECISION);
+        ASSERT_EQUAL(pruned[i].rating, all[i].rating);
+    }
+}
+
+void CheckQueries(const SearchServer& search_server, mt19937& generator) {
+    const vector<size_t> top_ks = {1, MAX_RESULT_DOCUMENT_COUNT, 20};
+    const int max_plus_word_count = static_cast<int>(PRUNING_MAX_QUERY_WORDS) + 2;
+    for (int plus_word_count = 1; plus_word_count <= max_plus_word_count; ++plus_word_count) {
+        for (const int minus_word_count : {0, 1, 3}) {
+            for (int round = 0; round < 4; ++round) {
+                const string query = GenerateQuery(generator, plus_word_count, minus_word_count);
+                for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+                    const vector<Document> all = search_server.FindTopDocuments(std::execution::par, query, status,
+                                                                                DOCUMENT_COUNT);
+                    for (const size_t top_k : top_ks) {
+                        CheckSameRanking(search_server.FindTopDocuments(std::execution::seq, query, status, top_k),
+                                         all, top_k);
+                    }
+                }
+                const auto is_even = [](int document_id, DocumentStatus, int) {
+                    return document_id % 2 == 0;
+                };
+                const vector<Document> all = search_server.FindTopDocuments(std::execution::par, query, is_even,
+                                                                            DOCUMENT_COUNT);
+                for (const size_t top_k : top_ks) {
+                    CheckSameRanking(search_server.FindTopDocuments(query, is_even, top_k), all, top_k);
+                }
+            }
+        }
+    }
+}
+
+void TestPrunedRankingMatchesExhaustive() {
+    for (const auto format : {PostingList::Format::PLAIN, PostingList::Format::COMPRESSED}) {
+        mt19937 generator(11);
+        SearchServer search_server = MakeServer(generator, format);
+        CheckQueries(search_server, generator);
+
+        // Removed documents stay in the lists as tombstones until Compact
+        for (int id = 0; id < DOCUMENT_COUNT; id += 4) {
+            search_server.RemoveDocument(id);
+        }
+        CheckQueries(search_server, generator);
+        search_server.Compact();
+        CheckQueries(search_server, generator);
+    }
+}
+
+int main() {
+    RUN_TEST(TestPrunedRankingMatchesExhaustive);
+}
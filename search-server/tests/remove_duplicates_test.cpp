@@ -0,0 +1,103 @@
+#include "remove_duplicates.h"
+
+#include "test_framework.h"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+string JoinWords(const string& prefix, int first, int last) {
+    string text;
+    for (int i = first; i < last; ++i) {
+        if (!text.empty()) {
+            text.push_back(' ');
+        }
+        text += prefix + to_string(i);
+    }
+    return text;
+}
+
+void TestExactDuplicates() {
+    SearchServer search_server("and with"s);
+    search_server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    search_server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(3, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(5, "funny funny pet and nasty nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(6, "funny pet and not very nasty rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(7, "very nasty rat and not very funny pet"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(8, "pet with rat and rat and rat"s, DocumentStatus::ACTUAL, {1, 2});
+    search_server.AddDocument(9, "nasty rat with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+
+    ASSERT_EQUAL(FindDuplicates(search_server), (vector<int>{3, 4, 5, 7}));
+    RemoveDuplicates(search_server);
+    ASSERT_EQUAL(search_server.GetDocumentCount(), 5);
+    ASSERT_EQUAL(vector<int>(search_server.begin(), search_server.end()), (vector<int>{1, 2, 6, 8, 9}));
+}
+
+void TestNearDuplicates() {
+    SearchServer search_server(""s);
+    // 20 words
+    search_server.AddDocument(1, JoinWords("w"s, 0, 20), DocumentStatus::ACTUAL, {1});
+    // 19 common words out of 22, similarity 0.86, and a different word count
+    search_server.AddDocument(2, JoinWords("w"s, 0, 19) + " x0 x1"s, DocumentStatus::ACTUAL, {1});
+    // 10 common words out of 30, similarity 0.33
+    search_server.AddDocument(3, JoinWords("w"s, 10, 20) + " "s + JoinWords("y"s, 0, 10), DocumentStatus::ACTUAL, {1});
+    // Nothing in common
+    search_server.AddDocument(4, JoinWords("z"s, 0, 15), DocumentStatus::ACTUAL, {1});
+    // Similarity 0.91 to 2, which is not kept, and 0.78 to 1
+    search_server.AddDocument(5, JoinWords("w"s, 0, 18) + " x0 x1 x2"s, DocumentStatus::ACTUAL, {1});
+    // Exact copy of 4
+    search_server.AddDocument(6, JoinWords("z"s, 0, 15), DocumentStatus::ACTUAL, {1});
+
+    DuplicateSearchOptions options;
+    options.similarity_threshold = 0.8;
+    ASSERT_EQUAL(FindDuplicates(search_server, options), (vector<int>{2, 6}));
+
+    options.similarity_threshold = 0.7;
+    ASSERT_EQUAL(FindDuplicates(search_server, options), (vector<int>{2, 5, 6}));
+
+    // 2 is kept now, and 5 is a copy of it
+    options.similarity_threshold = 0.9;
+    ASSERT_EQUAL(FindDuplicates(search_server, options), (vector<int>{5, 6}));
+
+    options.similarity_threshold = 0.95;
+    ASSERT_EQUAL(FindDuplicates(search_server, options), (vector<int>{6}));
+
+    // One row per band turns every shared signature value into a candidate pair
+    options.similarity_threshold = 0.3;
+    options.band_count = options.signature_size;
+    ASSERT_EQUAL(FindDuplicates(search_server, options), (vector<int>{2, 3, 5, 6}));
+
+    options.similarity_threshold = 0.8;
+    options.band_count = 0;
+    RemoveDuplicates(search_server, options);
+    ASSERT_EQUAL(vector<int>(search_server.begin(), search_server.end()), (vector<int>{1, 3, 4, 5}));
+}
+
+void TestInvalidOptions() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+
+    DuplicateSearchOptions options;
+    options.similarity_threshold = 0.0;
+    ASSERT_THROWS(FindDuplicates(search_server, options), invalid_argument);
+    options.similarity_threshold = 1.5;
+    ASSERT_THROWS(FindDuplicates(search_server, options), invalid_argument);
+
+    options.similarity_threshold = 0.5;
+    options.signature_size = 16;
+    options.band_count = 17;
+    ASSERT_THROWS(FindDuplicates(search_server, options), invalid_argument);
+    options.signature_size = 0;
+    options.band_count = 0;
+    ASSERT_THROWS(FindDuplicates(search_server, options), invalid_argument);
+}
+
+int main() {
+    RUN_TEST(TestExactDuplicates);
+    RUN_TEST(TestNearDuplicates);
+    RUN_TEST(TestInvalidOptions);
+}
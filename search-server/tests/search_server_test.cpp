@@ -0,0 +1,72 @@
+#include "search_server.h"
+
+#include "test_framework.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+vector<int> GetIds(const vector<Document>& documents) {
+    vector<int> ids;
+    for (const Document& document : documents) {
+        ids.push_back(document.id);
+    }
+    return ids;
+}
+
+void TestCopyOwnsItsIndex() {
+    auto original = make_unique<SearchServer>("and in"s);
+    original->SetResultCacheCapacity(100);
+    original->AddDocument(1, "white cat and fancy collar"s, DocumentStatus::ACTUAL, {8, -3});
+    original->AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    original->AddDocument(3, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, {5, -12, 2, 1});
+    original->AddDocument(4, "groomed starling evgeny"s, DocumentStatus::BANNED, {9});
+    original->RemoveDocument(2);
+    original->FindTopDocuments("fluffy groomed cat"s);
+    const auto prepared = original->PrepareQuery("fluffy groomed cat"s);
+    const vector<int> expected = GetIds(original->FindTopDocuments("fluffy groomed cat"s));
+    const auto original_frequencies = original->GetWordFrequencies(3);
+    const vector<pair<string, double>> expected_frequencies(original_frequencies.begin(), original_frequencies.end());
+
+    SearchServer copy(*original);
+    // The copy must not use anything of the original, the texts and words included
+    original.reset();
+
+    // Same capacity, none of the cached answers
+    ASSERT(copy.GetResultCache() != nullptr);
+    ASSERT_EQUAL(copy.GetResultCache()->GetCapacity(), 112u);
+    ASSERT_EQUAL(copy.GetResultCache()->GetHitCount(), 0u);
+    ASSERT_EQUAL(copy.GetResultCache()->GetMissCount(), 0u);
+
+    ASSERT(GetIds(copy.FindTopDocuments("fluffy groomed cat"s)) == expected);
+    ASSERT(GetIds(copy.FindTopDocuments(prepared)) == expected);
+    ASSERT(copy.FindTopDocuments("in"s).empty());
+    const auto [words, status] = copy.MatchDocument("white collar -dog"s, 1);
+    ASSERT((words == vector<string_view>{"collar"sv, "white"sv}));
+    ASSERT(status == DocumentStatus::ACTUAL);
+    const auto frequencies = copy.GetWordFrequencies(3);
+    ASSERT((vector<pair<string, double>>(frequencies.begin(), frequencies.end()) == expected_frequencies));
+
+    // Changes of the copy stay in it
+    SearchServer second_copy(copy);
+    copy.AddDocument(5, "fluffy cat"s, DocumentStatus::ACTUAL, {1});
+    copy.Compact();
+    ASSERT_EQUAL(copy.GetDocumentCount(), 4);
+    ASSERT_EQUAL(second_copy.GetDocumentCount(), 3);
+    ASSERT(GetIds(second_copy.FindTopDocuments("fluffy groomed cat"s)) == expected);
+}
+
+void TestCopyWithoutCache() {
+    SearchServer search_server(""s);
+    search_server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, {1});
+    const SearchServer copy(search_server);
+    ASSERT(copy.GetResultCache() == nullptr);
+    ASSERT_EQUAL(copy.FindTopDocuments("cat"s).size(), 1u);
+}
+
+int main() {
+    RUN_TEST(TestCopyOwnsItsIndex);
+    RUN_TEST(TestCopyWithoutCache);
+}
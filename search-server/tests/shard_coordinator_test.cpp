@@ -0,0 +1,209 @@
+#include "search_server.h"
+#include "shard_coordinator.h"
+
+#include "test_framework.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <signal.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+const string STOP_WORDS = "and in the"s;
+const size_t SHARD_COUNT = 3;
+
+// Shards still running, stopped at exit even when a check fails
+vector<pid_t> shard_pids;
+
+void KillShards() {
+    for (const pid_t pid : shard_pids) {
+        kill(pid, SIGKILL);
+        waitpid(pid, nullptr, 0);
+    }
+}
+
+vector<string> StartShards(const string& shard_path, const string& directory) {
+    vector<string> socket_paths;
+    for (size_t i = 0; i < SHARD_COUNT; ++i) {
+        socket_paths.push_back(directory + "/shard"s + to_string(i) + ".sock"s);
+        const char* arguments[] = {shard_path.c_str(), socket_paths.back().c_str(), STOP_WORDS.c_str(), nullptr};
+        const pid_t pid = fork();
+        ASSERT(pid >= 0);
+        if (pid == 0) {
+            // Killed with the test, whatever way it ends
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+            execv(shard_path.c_str(), const_cast<char**>(arguments));
+            _exit(127);
+        }
+        shard_pids.push_back(pid);
+    }
+    return socket_paths;
+}
+
+// The shards listen a moment after they start
+ShardCoordinator ConnectToShards(const vector<string>& socket_paths) {
+    const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+    while (true) {
+        try {
+            return ShardCoordinator(socket_paths);
+        } catch (const runtime_error&) {
+            ASSERT(chrono::steady_clock::now() < deadline);
+            this_thread::sleep_for(chrono::milliseconds(20));
+        }
+    }
+}
+
+void StopShards() {
+    for (const pid_t pid : shard_pids) {
+        ASSERT_EQUAL(kill(pid, SIGTERM), 0);
+        int status = 0;
+        ASSERT_EQUAL(waitpid(pid, &status, 0), pid);
+        ASSERT(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    shard_pids.clear();
+}
+
+vector<string> GenerateTexts(mt19937& generator, const vector<string>& dictionary, int text_count) {
+    vector<string> texts;
+    for (int i = 0; i < text_count; ++i) {
+        string text;
+        const int word_count = uniform_int_distribution(1, 20)(generator);
+        for (int j = 0; j < word_count; ++j) {
+            text += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)] + " "s;
+        }
+        text.pop_back();
+        texts.push_back(text);
+    }
+    return texts;
+}
+
+// Views of the texts, the document ids are their indexes
+vector<NewDocument> MakeDocuments(const vector<string>& texts) {
+    vector<NewDocument> documents;
+    for (int id = 0; id < static_cast<int>(texts.size()); ++id) {
+        const auto status = static_cast<DocumentStatus>(id % 5 == 0 ? id % 4 : 0);
+        // Distinct ratings, so that equal relevances still rank the same on both sides
+        documents.push_back({id, texts[id], status, {id, id + 2}});
+    }
+    return documents;
+}
+
+vector<string> GenerateQueries(mt19937& generator, const vector<string>& dictionary, int query_count) {
+    vector<string> queries;
+    for (int i = 0; i < query_count; ++i) {
+        string query;
+        const int word_count = uniform_int_distribution(1, 10)(generator);
+        for (int j = 0; j < word_count; ++j) {
+            if (uniform_int_distribution(0, 4)(generator) == 0) {
+                query.push_back('-');
+            }
+            query += dictionary[uniform_int_distribution<size_t>(0, dictionary.size() - 1)(generator)] + " "s;
+        }
+        query.pop_back();
+        queries.push_back(query);
+    }
+    return queries;
+}
+
+void CheckSameDocuments(const vector<Document>& sharded, const vector<Document>& single) {
+    ASSERT_EQUAL(sharded.size(), single.size());
+    for (size_t i = 0; i < sharded.size(); ++i) {
+        ASSERT_EQUAL(sharded[i].id, single[i].id);
+        ASSERT(abs(sharded[i].relevance - single[i].relevance) < PRECISION);
+        ASSERT_EQUAL(sharded[i].rating, single[i].rating);
+    }
+}
+
+void CheckSameResults(ShardCoordinator& coordinator, const SearchServer& search_server, const vector<string>& queries) {
+    ASSERT_EQUAL(coordinator.GetDocumentCount(), search_server.GetDocumentCount());
+    for (const string& query : queries) {
+        for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            for (const size_t top_k : {1, MAX_RESULT_DOCUMENT_COUNT, 50}) {
+                CheckSameDocuments(coordinator.FindTopDocuments(query, status, top_k),
+                                   search_server.FindTopDocuments(query, status, top_k));
+            }
+        }
+    }
+    for (const string& query : queries) {
+        for (const int document_id : search_server) {
+            const auto [sharded_words, sharded_status] = coordinator.MatchDocument(query, document_id);
+            const auto [words, status] = search_server.MatchDocument(query, document_id);
+            ASSERT(sharded_status == status);
+            ASSERT(sharded_words == vector<string>(words.begin(), words.end()));
+        }
+    }
+}
+
+void TestShardProcesses(const string& shard_path) {
+    char directory_template[] = "/tmp/shard_test_XXXXXX";
+    ASSERT(mkdtemp(directory_template) != nullptr);
+    const string directory = directory_template;
+    ShardCoordinator coordinator = ConnectToShards(StartShards(shard_path, directory));
+    ASSERT_EQUAL(coordinator.GetShardCount(), SHARD_COUNT);
+
+    mt19937 generator(7);
+    vector<string> dictionary;
+    for (int i = 0; i < 150; ++i) {
+        dictionary.push_back("w"s + to_string(i));
+    }
+    dictionary.push_back("the"s);
+    const vector<string> texts = GenerateTexts(generator, dictionary, 300);
+    const vector<NewDocument> documents = MakeDocuments(texts);
+    const vector<string> queries = GenerateQueries(generator, dictionary, 40);
+
+    SearchServer search_server(STOP_WORDS);
+    search_server.AddDocuments(vector<NewDocument>(documents.begin(), documents.begin() + 200));
+    coordinator.AddDocuments(vector<NewDocument>(documents.begin(), documents.begin() + 200));
+    for (size_t i = 200; i < documents.size(); ++i) {
+        const NewDocument& document = documents[i];
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        coordinator.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    CheckSameResults(coordinator, search_server, queries);
+
+    for (int document_id = 0; document_id < 300; document_id += 3) {
+        search_server.RemoveDocument(document_id);
+        coordinator.RemoveDocument(document_id);
+    }
+    // Unknown ids are ignored by both
+    search_server.RemoveDocument(1000);
+    coordinator.RemoveDocument(1000);
+    CheckSameResults(coordinator, search_server, queries);
+
+    // Errors come back as the exceptions SearchServer throws
+    ASSERT_THROWS(coordinator.MatchDocument("w1"s, 0), out_of_range);
+    ASSERT_THROWS(coordinator.FindTopDocuments("w1 --w2"s), invalid_argument);
+    ASSERT_THROWS(coordinator.AddDocument(1, "w1"s, DocumentStatus::ACTUAL, {1}), invalid_argument);
+    ASSERT_EQUAL(coordinator.GetDocumentCount(), search_server.GetDocumentCount());
+
+    StopShards();
+    ASSERT_EQUAL(rmdir(directory.c_str()), 0);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        cerr << "Usage: " << argv[0] << " SEARCH_SHARD_PATH" << endl;
+        return 2;
+    }
+    atexit(KillShards);
+    const string shard_path = argv[1];
+    try {
+        RUN_TEST([&shard_path] {
+            TestShardProcesses(shard_path);
+        });
+    } catch (const exception& e) {
+        cerr << "Unexpected exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,254 @@
+#include "search_server.h"
+#include "snapshot_file.h"
+
+#include "test_framework.h"
+
+#include <cmath>
+#include <cstring>
+#include <execution>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+
+// Layout of the file header and of a section table entry, which the corruption
+// tests patch in place
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order_mark;
+    uint64_t section_table_offset;
+    uint64_t section_count;
+};
+
+struct SectionEntry {
+    uint32_t id;
+    uint32_t element_size;
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Section ids of SearchServer snapshots
+const uint32_t TERM_OFFSETS_SECTION = 3;
+const uint32_t POSTING_LISTS_SECTION = 5;
+
+string temporary_directory;
+
+string GetPath(const string& name) {
+    return temporary_directory + "/"s + name;
+}
+
+string ReadFile(const string& path) {
+    ifstream in(path, ios::binary);
+    return {istreambuf_iterator<char>(in), istreambuf_iterator<char>()};
+}
+
+void WriteFile(const string& path, const string& content) {
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write(content.data(), static_cast<streamsize>(content.size()));
+    ASSERT(out.good());
+}
+
+template <typename T>
+T ReadValue(const string& content, size_t offset) {
+    T value;
+    memcpy(&value, content.data() + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+void WriteValue(string& content, size_t offset, const T& value) {
+    memcpy(content.data() + offset, &value, sizeof(T));
+}
+
+// Offset of the section table entry with the given id
+size_t FindSectionEntry(const string& content, uint32_t section_id) {
+    const auto header = ReadValue<FileHeader>(content, 0);
+    for (uint64_t i = 0; i < header.section_count; ++i) {
+        const size_t offset = header.section_table_offset + i * sizeof(SectionEntry);
+        if (ReadValue<SectionEntry>(content, offset).id == section_id) {
+            return offset;
+        }
+    }
+    FailTest("section " + to_string(section_id) + " is in the table", __FILE__, __LINE__);
+    return 0;
+}
+
+SearchServer MakeServer(PostingList::Format format) {
+    SearchServer search_server("and with"s);
+    search_server.SetPostingFormat(format);
+    for (int id = 0; id < 600; ++id) {
+        string text = "cat"s + to_string(id % 37) + " dog"s + to_string(id % 11) + " and bird"s;
+        if (id % 3 == 0) {
+            text += " fish fish"s;
+        }
+        // Distinct ratings, so that documents of equal relevance always come in the same order
+        search_server.AddDocument(id * 2, text, static_cast<DocumentStatus>(id % 4), {id});
+    }
+    // Removed documents are left out of the snapshot
+    for (int id = 0; id < 1200; id += 10) {
+        search_server.RemoveDocument(id);
+    }
+    return search_server;
+}
+
+void CheckSameIndex(const SearchServer& expected, const SearchServer& snapshot) {
+    ASSERT_EQUAL(snapshot.GetDocumentCount(), expected.GetDocumentCount());
+    ASSERT(vector<int>(snapshot.begin(), snapshot.end()) == vector<int>(expected.begin(), expected.end()));
+    for (const int document_id : expected) {
+        const auto expected_words = expected.GetWordFrequencies(document_id);
+        const auto words = snapshot.GetWordFrequencies(document_id);
+        ASSERT(vector(words.begin(), words.end()) == vector(expected_words.begin(), expected_words.end()));
+    }
+    const vector<string> queries = {"cat1 dog2"s, "bird -fish"s, "fish cat7 cat8 dog10"s, "and with"s, "unknown"s};
+    for (const string& query : queries) {
+        for (const auto status : {DocumentStatus::ACTUAL, DocumentStatus::BANNED}) {
+            const auto expected_documents = expected.FindTopDocuments(query, status, 50);
+            for (const auto& documents : {snapshot.FindTopDocuments(query, status, 50),
+                                          snapshot.FindTopDocuments(std::execution::par, query, status, 50)}) {
+                ASSERT_EQUAL(documents.size(), expected_documents.size());
+                for (size_t i = 0; i < documents.size(); ++i) {
+                    ASSERT_EQUAL(documents[i].id, expected_documents[i].id);
+                    ASSERT(abs(documents[i].relevance - expected_documents[i].relevance) < PRECISION);
+                    ASSERT_EQUAL(documents[i].rating, expected_documents[i].rating);
+                }
+            }
+        }
+        for (const int document_id : expected) {
+            const auto [expected_words, expected_status] = expected.MatchDocument(query, document_id);
+            const auto [words, status] = snapshot.MatchDocument(query, document_id);
+            ASSERT(words == expected_words);
+            ASSERT(status == expected_status);
+        }
+    }
+}
+
+void TestRoundTrip() {
+    for (const auto format : {PostingList::Format::PLAIN, PostingList::Format::COMPRESSED}) {
+        const SearchServer search_server = MakeServer(format);
+        const string path = GetPath("index.snap"s);
+        search_server.SaveSnapshot(path);
+        SearchServer snapshot = SearchServer::OpenSnapshot(path);
+        CheckSameIndex(search_server, snapshot);
+
+        // Stop words come back with the snapshot
+        ASSERT(snapshot.FindTopDocuments("and"s).empty());
+        ASSERT_THROWS(snapshot.AddDocument(5000, "cat"s, DocumentStatus::ACTUAL, {1}), logic_error);
+        ASSERT_THROWS(snapshot.RemoveDocument(2), logic_error);
+        ASSERT_THROWS(snapshot.SaveSnapshot(GetPath("copy.snap"s)), logic_error);
+        ASSERT_EQUAL(unlink(path.c_str()), 0);
+    }
+}
+
+void TestEmptyIndex() {
+    const SearchServer search_server(""s);
+    const string path = GetPath("empty.snap"s);
+    search_server.SaveSnapshot(path);
+    const SearchServer snapshot = SearchServer::OpenSnapshot(path);
+    ASSERT_EQUAL(snapshot.GetDocumentCount(), 0);
+    ASSERT(snapshot.FindTopDocuments("cat"s).empty());
+    ASSERT_EQUAL(unlink(path.c_str()), 0);
+}
+
+// The file must be rejected with std::runtime_error, never read out of bounds
+void CheckRejected(const string& content) {
+    const string path = GetPath("corrupted.snap"s);
+    WriteFile(path, content);
+    ASSERT_THROWS(SearchServer::OpenSnapshot(path), runtime_error);
+    ASSERT_EQUAL(unlink(path.c_str()), 0);
+}
+
+void TestCorruptedFiles() {
+    const string path = GetPath("index.snap"s);
+    MakeServer(PostingList::Format::COMPRESSED).SaveSnapshot(path);
+    const string content = ReadFile(path);
+    ASSERT_EQUAL(unlink(path.c_str()), 0);
+    ASSERT(content.size() > sizeof(FileHeader));
+
+    ASSERT_THROWS(SearchServer::OpenSnapshot(GetPath("missing.snap"s)), runtime_error);
+
+    string other_version = content;
+    WriteValue(other_version, offsetof(FileHeader, version), ReadValue<uint32_t>(content, offsetof(FileHeader, version)) + 1);
+    CheckRejected(other_version);
+
+    string other_magic = content;
+    other_magic[0] = 'X';
+    CheckRejected(other_magic);
+
+    for (const size_t size : {size_t(0), sizeof(FileHeader) - 1, sizeof(FileHeader), content.size() / 2,
+                              content.size() - 1}) {
+        CheckRejected(content.substr(0, size));
+    }
+
+    string bad_table_offset = content;
+    WriteValue(bad_table_offset, offsetof(FileHeader, section_table_offset), uint64_t(content.size() + 8));
+    CheckRejected(bad_table_offset);
+
+    string bad_section_count = content;
+    WriteValue(bad_section_count, offsetof(FileHeader, section_count), ~uint64_t(0));
+    CheckRejected(bad_section_count);
+
+    // A section running past the end of the file, and one starting there
+    const size_t posting_lists_entry = FindSectionEntry(content, POSTING_LISTS_SECTION);
+    string bad_section_size = content;
+    WriteValue(bad_section_size, posting_lists_entry + offsetof(SectionEntry, size), uint64_t(content.size()));
+    CheckRejected(bad_section_size);
+    string bad_section_offset = content;
+    WriteValue(bad_section_offset, posting_lists_entry + offsetof(SectionEntry, offset), ~uint64_t(0));
+    CheckRejected(bad_section_offset);
+    string bad_element_size = content;
+    WriteValue(bad_element_size, posting_lists_entry + offsetof(SectionEntry, element_size), uint32_t(1));
+    CheckRejected(bad_element_size);
+
+    // Every range of a posting list record pointing past its section. The first
+    // seven fields of a record are the offsets and counts
+    const auto posting_lists = ReadValue<SectionEntry>(content, posting_lists_entry);
+    for (size_t field = 0; field < 7; ++field) {
+        string bad_record = content;
+        WriteValue(bad_record, posting_lists.offset + field * sizeof(uint64_t), uint64_t(1) << 40);
+        CheckRejected(bad_record);
+    }
+
+    // Word offsets going backwards
+    const auto term_offsets = ReadValue<SectionEntry>(content, FindSectionEntry(content, TERM_OFFSETS_SECTION));
+    string bad_term_offsets = content;
+    WriteValue(bad_term_offsets, term_offsets.offset + sizeof(uint64_t), uint64_t(1) << 40);
+    CheckRejected(bad_term_offsets);
+}
+
+void TestSnapshotFile() {
+    const string path = GetPath("sections.snap"s);
+    SnapshotWriter writer(path, 7);
+    writer.WriteSection(1, vector<uint32_t>{1, 2, 3});
+    writer.WriteSection(2, vector<double>{0.5});
+    writer.WriteSection(3, vector<char>{});
+    writer.Finish();
+
+    const MappedSnapshot snapshot(path, 7);
+    const auto first = snapshot.GetSection<uint32_t>(1);
+    ASSERT(vector<uint32_t>(first.begin(), first.end()) == (vector<uint32_t>{1, 2, 3}));
+    ASSERT_EQUAL(snapshot.GetSection<double>(2)[0], 0.5);
+    ASSERT_EQUAL(snapshot.GetSection<char>(3).size(), 0u);
+    // Missing sections and sections of other values
+    ASSERT_THROWS(snapshot.GetSection<uint32_t>(4), runtime_error);
+    ASSERT_THROWS(snapshot.GetSection<uint64_t>(1), runtime_error);
+
+    ASSERT_THROWS(MappedSnapshot(path, 8), runtime_error);
+    ASSERT_EQUAL(unlink(path.c_str()), 0);
+}
+
+int main() {
+    char directory_template[] = "/tmp/snapshot_test_XXXXXX";
+    ASSERT(mkdtemp(directory_template) != nullptr);
+    temporary_directory = directory_template;
+    RUN_TEST(TestRoundTrip);
+    RUN_TEST(TestEmptyIndex);
+    RUN_TEST(TestCorruptedFiles);
+    RUN_TEST(TestSnapshotFile);
+    ASSERT_EQUAL(rmdir(temporary_directory.c_str()), 0);
+}
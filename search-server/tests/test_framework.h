@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// Checks for the test executables. A failed check prints where it failed and exits
+// with a failure code, which ctest reports
+
+inline void FailTest(const std::string& expression, const std::string& file, unsigned line) {
+    std::cerr << file << "(" << line << "): check failed: " << expression << std::endl;
+    std::exit(EXIT_FAILURE);
+}
+
+#define ASSERT(expr) \
+    do { \
+        if (!(expr)) { \
+            FailTest(#expr, __FILE__, __LINE__); \
+        } \
+    } while (false)
+
+#define ASSERT_EQUAL(lhs, rhs) \
+    do { \
+        if (!((lhs) == (rhs))) { \
+            FailTest(#lhs " == " #rhs, __FILE__, __LINE__); \
+        } \
+    } while (false)
+
+#define ASSERT_THROWS(expr, exception_type) \
+    do { \
+        bool thrown = false; \
+        try { \
+            expr; \
+        } catch (const exception_type&) { \
+            thrown = true; \
+        } \
+        if (!thrown) { \
+            FailTest(#expr " throws " #exception_type, __FILE__, __LINE__); \
+        } \
+    } while (false)
+
+template <typename TestFunction>
+void RunTestImpl(TestFunction test, const std::string& name) {
+    test();
+    std::cerr << name << " OK" << std::endl;
+}
+
+#define RUN_TEST(func) RunTestImpl(func, #func)
@@ -0,0 +1,26 @@
+#include "text_arena.h"
+
+#include <algorithm>
+
+std::string_view TextArena::Store(std::string_view text) {
+    if (text.empty()) {
+        return {};
+    }
+    if (text.size() > chunk_size_) {
+        // Keeps the free space of the current chunk for the following texts
+        chunks_.emplace_back(new char[text.size()]);
+        allocated_size_ += text.size();
+        std::copy(text.begin(), text.end(), chunks_.back().get());
+        return {chunks_.back().get(), text.size()};
+    }
+    if (static_cast<size_t>(free_end_ - free_begin_) < text.size()) {
+        chunks_.emplace_back(new char[chunk_size_]);
+        allocated_size_ += chunk_size_;
+        free_begin_ = chunks_.back().get();
+        free_end_ = free_begin_ + chunk_size_;
+    }
+    char* const stored = free_begin_;
+    std::copy(text.begin(), text.end(), stored);
+    free_begin_ += text.size();
+    return {stored, text.size()};
+}
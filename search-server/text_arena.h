@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// Append-only storage of strings in large chunks. A stored string never moves,
+// so views of it stay valid for the lifetime of the arena. Single strings can
+// not be freed, space is reclaimed by copying the live ones into a new arena
+class TextArena {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+    explicit TextArena(size_t chunk_size = DEFAULT_CHUNK_SIZE)
+            : chunk_size_(chunk_size) {
+    }
+
+    // Copies the text into the arena. Texts longer than the chunk size get a chunk of their own
+    std::string_view Store(std::string_view text);
+
+    // Bytes taken by the chunks, including their unused tails
+    size_t GetAllocatedSize() const noexcept {
+        return allocated_size_;
+    }
+
+private:
+    size_t chunk_size_;
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    // Free space of the last regular chunk
+    char* free_begin_ = nullptr;
+    char* free_end_ = nullptr;
+    size_t allocated_size_ = 0;
+};